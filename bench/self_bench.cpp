@@ -0,0 +1,423 @@
+/*
+self_bench - measures the overhead of µTest itself
+
+Registers tens of thousands of synthetic tests and times the parts of the framework every test
+pays for: static registration, dispatch through Runner::run, passing and failing asserts, and
+how fast the reporters take results. Run it before and after a change to upptest.h:
+
+	g++ -std=c++14 -O2 -pthread self_bench.cpp -o self_bench
+	./self_bench --record before.txt
+	(change the header, rebuild)
+	./self_bench --compare before.txt
+
+--compare exits with 1 when any measurement is more than --threshold (0.2, so 20%, by default)
+slower than the recorded one. --tests sets the suite sizes, 10000,100000 by default. Every
+figure is the fastest of several repetitions, in nanoseconds per test, assert or result. On a
+shared machine, rerun a flagged comparison or raise the threshold before believing it.
+*/
+
+#define UTEST_CPP_IMPLEMENTATION
+#include "../upptest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+
+namespace
+{
+	const unsigned repetitions = 7;
+
+	enum class Mode
+	{
+		pass,
+		assert_fail,
+		expect_fail
+	};
+
+	Mode g_mode = Mode::pass;
+	int g_value = 42;
+
+	// The one body all synthetic tests share: a single assert, which passes or fails by g_mode
+	class Synthetic_Test : public utest::Test
+	{
+	public:
+		static std::unique_ptr<utest::Test> create() { return std::make_unique<Synthetic_Test>(); }
+		static utest::Test* emplace(void* storage) { return ::new (storage) Synthetic_Test(); }
+
+	private:
+		void execute_test() override
+		{
+			switch (g_mode)
+			{
+			case Mode::pass:
+				UASSERT_EQ(42, g_value);
+				break;
+			case Mode::assert_fail:
+				UASSERT_EQ(41, g_value);
+				break;
+			case Mode::expect_fail:
+				UEXPECT_EQ(41, g_value);
+				break;
+			}
+		}
+	};
+
+	// `count` tests described the way TEST_F_OPT describes them, registered on demand
+	class Synthetic_Suite
+	{
+	public:
+		explicit Synthetic_Suite(const size_t count)
+			: _names()
+			, _infos()
+			, _registrations()
+		{
+			_names.reserve(count);
+			_infos.reserve(count);
+			_registrations.reserve(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				_names.push_back("Synthetic" + std::to_string(count) + "_" + std::to_string(i));
+			}
+			for (size_t i = 0; i < count; ++i)
+			{
+				_infos.emplace_back(&Synthetic_Test::create, &Synthetic_Test::emplace, sizeof(Synthetic_Test),
+					alignof(Synthetic_Test), _names[i].c_str(), i % 2 ? "Bench.Odd" : "Bench.Even", __FILE__,
+					static_cast<int>(i), utest::Test_Options());
+			}
+		}
+
+		// what the Auto_Registered_Test of each TEST does during static initialization
+		void register_all()
+		{
+			for (auto& info : _infos)
+			{
+				_registrations.emplace_back(&info);
+			}
+		}
+
+		std::vector<const utest::Info*> tests() const
+		{
+			std::vector<const utest::Info*> out;
+			out.reserve(_infos.size());
+			for (const auto& info : _infos)
+			{
+				out.push_back(&info);
+			}
+			return out;
+		}
+
+		size_t size() const { return _infos.size(); }
+
+	private:
+		std::vector<std::string> _names;
+		std::vector<utest::Info> _infos;
+		std::vector<utest::Auto_Registered_Test> _registrations;
+	};
+
+	std::vector<std::unique_ptr<Synthetic_Suite>> g_suites;
+
+	// discards everything, so a reporter is measured without the cost of the device behind it
+	class Null_Buffer : public std::streambuf
+	{
+	protected:
+		int_type overflow(const int_type c) override { return traits_type::not_eof(c); }
+		std::streamsize xsputn(const char*, const std::streamsize n) override { return n; }
+	};
+
+	double elapsed_ns(const std::chrono::steady_clock::time_point start)
+	{
+		return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count());
+	}
+
+	// the fastest repetition, which is the one least disturbed by the rest of the machine
+	template<typename Func>
+	double best_ns(const size_t ops, Func func)
+	{
+		double best = 0;
+		for (unsigned r = 0; r < repetitions; ++r)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			func();
+			const double ns = elapsed_ns(start) / static_cast<double>(ops);
+			best = r == 0 ? ns : std::min(best, ns);
+		}
+		return best;
+	}
+
+	class Measurements
+	{
+	public:
+		void add(const std::string& name, const double ns)
+		{
+			std::printf("  %-40s %12.1f ns\n", name.c_str(), ns);
+			std::fflush(stdout);
+			_values.emplace_back(name, ns);
+		}
+
+		bool save(const std::string& path) const
+		{
+			std::ofstream out(path);
+			for (const auto& v : _values)
+			{
+				out << v.first << " " << v.second << "\n";
+			}
+			return static_cast<bool>(out);
+		}
+
+		// the number of measurements slower than the recorded ones by more than `threshold`
+		int compare(const std::string& path, const double threshold) const
+		{
+			std::ifstream in(path);
+			if (!in)
+			{
+				std::fprintf(stderr, "cannot read %s\n", path.c_str());
+				return -1;
+			}
+			std::map<std::string, double> recorded;
+			std::string name;
+			double ns;
+			while (in >> name >> ns)
+			{
+				recorded[name] = ns;
+			}
+			int regressed = 0;
+			for (const auto& v : _values)
+			{
+				const auto it = recorded.find(v.first);
+				if (it == recorded.end() || it->second <= 0)
+				{
+					continue;
+				}
+				const double change = v.second / it->second - 1.0;
+				if (change > threshold)
+				{
+					std::printf("REGRESSED %-40s %12.1f ns, was %.1f ns (+%.0f%%)\n", v.first.c_str(), v.second, it->second,
+						change * 100.0);
+					++regressed;
+				}
+			}
+			return regressed;
+		}
+
+	private:
+		std::vector<std::pair<std::string, double>> _values;
+	};
+
+	void expect_status(const utest::Status got, const utest::Status wanted, const char* what)
+	{
+		if (got != wanted)
+		{
+			std::fprintf(stderr, "%s: run finished %s, expected %s\n", what, utest::status_name(got),
+				utest::status_name(wanted));
+			std::exit(2);
+		}
+	}
+
+	void measure_suite(Measurements& m, const size_t count)
+	{
+		const std::string n = "/" + std::to_string(count);
+		std::printf("%zu tests\n", count);
+
+		// Registration can't be undone, so each repetition registers a suite of its own, and like
+		// real tests they stay registered until the program exits. The index is rebuilt over every
+		// registered test, so it is costed per indexed test.
+		std::vector<double> link, sync, index;
+		for (unsigned r = 0; r < repetitions; ++r)
+		{
+			g_suites.push_back(std::make_unique<Synthetic_Suite>(count));
+			auto start = std::chrono::steady_clock::now();
+			g_suites.back()->register_all();
+			link.push_back(elapsed_ns(start) / static_cast<double>(count));
+			start = std::chrono::steady_clock::now();
+			utest::do_not_optimize(utest::Registry::get().tests().size());
+			sync.push_back(elapsed_ns(start) / static_cast<double>(count));
+			start = std::chrono::steady_clock::now();
+			const size_t indexed = utest::Registry::get().index().size();
+			index.push_back(elapsed_ns(start) / static_cast<double>(indexed));
+		}
+		m.add("register.link" + n, *std::min_element(link.begin(), link.end()));
+		m.add("register.first_tests_call" + n, *std::min_element(sync.begin(), sync.end()));
+		m.add("register.index" + n, *std::min_element(index.begin(), index.end()));
+
+		const auto tests = g_suites.back()->tests();
+		auto ignore = [](const utest::Result&) {};
+
+		g_mode = Mode::pass;
+		m.add("dispatch.serial.pass" + n, best_ns(count, [&]()
+		{
+			expect_status(utest::Runner::run(tests, ignore), utest::Status::pass, "serial");
+		}));
+		m.add("dispatch.parallel.pass" + n, best_ns(count, [&]()
+		{
+			expect_status(utest::Runner::run_parallel(tests, ignore), utest::Status::pass, "parallel");
+		}));
+
+		g_mode = Mode::assert_fail;
+		m.add("dispatch.serial.assert_fail" + n, best_ns(count, [&]()
+		{
+			expect_status(utest::Runner::run(tests, ignore), utest::Status::fail, "serial assert_fail");
+		}));
+		g_mode = Mode::expect_fail;
+		m.add("dispatch.serial.expect_fail" + n, best_ns(count, [&]()
+		{
+			expect_status(utest::Runner::run(tests, ignore), utest::Status::fail, "serial expect_fail");
+		}));
+		g_mode = Mode::pass;
+	}
+
+	void measure_asserts(Measurements& m)
+	{
+		std::printf("asserts\n");
+		// A passing assert is one compare and a predicted branch, so this is mostly the load and
+		// do_not_optimize() around it; what it guards against is the pass path growing.
+		const size_t count = 20000000;
+		m.add("assert.eq.pass", best_ns(count, [&]()
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				int v = g_value;
+				utest::do_not_optimize(v);
+				utest::assert::eq(42, v, __FILE__, __LINE__);
+			}
+		}));
+
+#if !UTEST_CPP_NO_EXCEPTIONS
+		// Default_Fail_Handler throws; the runner's catch is what every failing assert goes through
+		const size_t failures = 200000;
+		m.add("assert.eq.fail", best_ns(failures, [&]()
+		{
+			for (size_t i = 0; i < failures; ++i)
+			{
+				try
+				{
+					utest::assert::eq(41, g_value, __FILE__, __LINE__);
+				}
+				catch (const utest::assert_fail_exception& ex)
+				{
+					utest::do_not_optimize(ex.failure().line());
+				}
+			}
+		}));
+#endif
+	}
+
+	template<class Reporter_Type>
+	void measure_reporter(Measurements& m, const char* name, const std::vector<utest::Result>& results)
+	{
+		Null_Buffer buffer;
+		std::ostream os(&buffer);
+		m.add(std::string("observer.") + name, best_ns(results.size(), [&]()
+		{
+			Reporter_Type reporter(os);
+			for (const auto& res : results)
+			{
+				reporter(res);
+			}
+			reporter.finish();
+		}));
+	}
+
+	void measure_observers(Measurements& m)
+	{
+		std::printf("observers\n");
+		Synthetic_Suite suite(10000);
+		std::vector<utest::Result> results;
+		results.reserve(suite.size());
+		const auto tests = suite.tests();
+		for (size_t i = 0; i < tests.size(); ++i)
+		{
+			g_mode = i % 10 ? Mode::pass : Mode::assert_fail;	// one in ten carries a failure message
+			utest::Result res;
+			utest::Runner::run(tests[i], res);
+			results.push_back(std::move(res));
+		}
+		g_mode = Mode::pass;
+
+		measure_reporter<utest::Json_Lines_Reporter>(m, "json_lines", results);
+		measure_reporter<utest::Junit_Reporter>(m, "junit", results);
+		measure_reporter<utest::Tap_Reporter>(m, "tap", results);
+		measure_reporter<utest::Result_Log_Reporter>(m, "result_log", results);
+	}
+
+	std::vector<size_t> parse_sizes(const char* list)
+	{
+		std::vector<size_t> sizes;
+		for (const char* p = list; *p;)
+		{
+			char* end;
+			const unsigned long long n = std::strtoull(p, &end, 10);
+			if (end == p)
+			{
+				break;
+			}
+			sizes.push_back(static_cast<size_t>(n));
+			p = *end == ',' ? end + 1 : end;
+		}
+		return sizes;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<size_t> sizes = { 10000, 100000 };
+	const char* record = nullptr;
+	const char* compare = nullptr;
+	double threshold = 0.20;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--tests" && i + 1 < argc)
+		{
+			sizes = parse_sizes(argv[++i]);
+		}
+		else if (arg == "--record" && i + 1 < argc)
+		{
+			record = argv[++i];
+		}
+		else if (arg == "--compare" && i + 1 < argc)
+		{
+			compare = argv[++i];
+		}
+		else if (arg == "--threshold" && i + 1 < argc)
+		{
+			threshold = std::atof(argv[++i]);
+		}
+		else
+		{
+			std::fprintf(stderr, "usage: %s [--tests N,N...] [--record file] [--compare file] [--threshold fraction]\n",
+				argv[0]);
+			return 2;
+		}
+	}
+
+	Measurements m;
+	for (const size_t count : sizes)
+	{
+		measure_suite(m, count);
+	}
+	measure_asserts(m);
+	measure_observers(m);
+
+	if (record && !m.save(record))
+	{
+		std::fprintf(stderr, "cannot write %s\n", record);
+		return 2;
+	}
+	if (compare)
+	{
+		const int regressed = m.compare(compare, threshold);
+		if (regressed < 0)
+		{
+			return 2;
+		}
+		if (regressed > 0)
+		{
+			return 1;
+		}
+		std::printf("no regressions against %s\n", compare);
+	}
+	return 0;
+}
@@ -0,0 +1,2220 @@
+/*
+self_test - µTest's tests of itself
+
+Each test runs a small inner test, which is not registered, and checks the Result it produced.
+There is no build system; compile it next to the header and run it:
+
+	g++ -std=c++14 -O1 -pthread self_test.cpp -o self_test
+	./self_test
+
+It exits with 0 when every test passes. Building with -fsanitize=address as well catches
+failures that read memory their test has already released. The allocation tests need the
+tracking built in:
+
+	g++ -std=c++14 -O1 -pthread -DUTEST_CPP_TRACK_ALLOCATIONS=1 self_test.cpp -o self_test
+
+and the tests of the setjmp/longjmp assert path need exceptions disabled:
+
+	g++ -std=c++14 -O1 -pthread -fno-exceptions self_test.cpp -o self_test
+
+The jump out of a failed assert skips the destructors of the inner test's locals, so a leak checker
+will report those strings in this build.
+
+The hardware counter tests need the counters built in. Where the kernel doesn't allow them, the
+tests check that the counters are left empty instead:
+
+	g++ -std=c++14 -O1 -pthread -DUTEST_CPP_PERF_COUNTERS=1 self_test.cpp -o self_test
+
+The coroutine tests need C++20:
+
+	g++ -std=c++20 -O1 -pthread self_test.cpp -o self_test
+*/
+
+#define UTEST_CPP_IMPLEMENTATION
+#include "../upptest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <thread>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+namespace
+{
+	// runs a test outside the registry, the way Runner::run() would
+	template<class Inner_Test>
+	utest::Result run_inner()
+	{
+		Inner_Test inner;
+		utest::Result res;
+		inner.execute(res);
+		return res;
+	}
+
+	// an unregistered Info for the inner test, for the runners
+	template<class Inner_Test>
+	const utest::Info* inner_info()
+	{
+		struct Factory
+		{
+			static std::unique_ptr<utest::Test> create() { return std::make_unique<Inner_Test>(); }
+		};
+		static const utest::Info info(&Factory::create, "Inner", "SelfTest.Inner", __FILE__, __LINE__);
+		return &info;
+	}
+
+	// runs a test outside the registry through Runner::run(), so the run options apply
+	template<class Inner_Test>
+	utest::Result run_inner(const utest::Run_Options& options)
+	{
+		utest::Result res;
+		utest::Runner::run(inner_info<Inner_Test>(), res, options);
+		return res;
+	}
+
+	// a trivially copyable view into memory the test owns
+	struct Text_View
+	{
+		const char* data;
+		size_t size;
+
+		bool operator == (const Text_View& other) const
+		{
+			return size == other.size && std::memcmp(data, other.data, size) == 0;
+		}
+	};
+
+	std::ostream& operator << (std::ostream& os, const Text_View& v)
+	{
+		return os.write(v.data, static_cast<std::streamsize>(v.size));
+	}
+
+	class View_Mismatch : public utest::Test
+	{
+		void execute_test() override
+		{
+			const std::string expected("expected text that is long enough to live on the heap");
+			const std::string actual("actual text that is long enough to live on the heap too");
+			UASSERT_EQ((Text_View{ expected.data(), expected.size() }), (Text_View{ actual.data(), actual.size() }));
+		}
+	};
+
+#if __cplusplus >= 201703L
+	class String_View_Mismatch : public utest::Test
+	{
+		void execute_test() override
+		{
+			const std::string expected("expected text that is long enough to live on the heap");
+			const std::string actual("actual text that is long enough to live on the heap too");
+			UASSERT_EQ(std::string_view(expected), std::string_view(actual));
+		}
+	};
+#endif
+
+	class Number_Mismatch : public utest::Test
+	{
+		void execute_test() override
+		{
+			const int expected = 3;
+			const long actual = 4;
+			UEXPECT_EQ(expected, actual);
+		}
+	};
+
+	class Multi_Line_Mismatch : public utest::Test
+	{
+		void execute_test() override
+		{
+			UEXPECT_EQ(std::string("first\tline\nsecond"), std::string("first\tline\r\nsecond"));
+		}
+	};
+
+	class Passer : public utest::Test
+	{
+		void execute_test() override {}
+	};
+
+	bool contains(const std::string& text, const char* part)
+	{
+		return text.find(part) != std::string::npos;
+	}
+
+	// an unregistered Info of its own, for tests that tell inner tests apart by name
+	template<class Inner_Test>
+	const utest::Info* named_info(const std::string& name, const char* category = "SelfTest.Inner",
+		const utest::Test_Options& options = utest::Test_Options())
+	{
+		struct Factory
+		{
+			static std::unique_ptr<utest::Test> create() { return std::make_unique<Inner_Test>(); }
+		};
+		static std::deque<std::string> names;
+		static std::deque<utest::Info> infos;
+		names.push_back(name);
+		infos.emplace_back(&Factory::create, nullptr, 0, 0, names.back().c_str(), category, __FILE__, __LINE__, options,
+			nullptr, utest::detail::suite_of<Inner_Test>(0));
+		return &infos.back();
+	}
+
+	// a file in the working directory that is removed again when the test is done with it
+	struct Temp_File
+	{
+		explicit Temp_File(const char* name_)
+			: name(std::string("self_test_") + name_)
+		{
+			std::remove(name.c_str());
+		}
+
+		~Temp_File() { std::remove(name.c_str()); }
+
+		void write(const void* data, const size_t size) const
+		{
+			std::ofstream out(name, std::ios::binary | std::ios::trunc);
+			out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		}
+
+		std::string name;
+	};
+
+	// a result the runner would have recorded for the test
+	utest::Result timed_result(const utest::Info* ti, const long long nanoseconds)
+	{
+		utest::Result res;
+		res.info = ti;
+		res.status = utest::Status::pass;
+		res.duration = std::chrono::nanoseconds(nanoseconds);
+		return res;
+	}
+}
+
+namespace
+{
+	class Napper : public utest::Test
+	{
+		void execute_test() override
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	};
+
+	// every fourth test is slow, and they all start on the first worker's queue
+	std::vector<const utest::Info*> uneven_tests()
+	{
+		static std::vector<const utest::Info*> tests;
+		if (tests.empty())
+		{
+			for (int i = 0; i < 32; ++i)
+			{
+				const std::string name = "Uneven" + std::to_string(i);
+				tests.push_back(i % 4 == 0 ? named_info<Napper>(name) : i % 3 == 0 ? named_info<Number_Mismatch>(name)
+					: named_info<Passer>(name));
+			}
+		}
+		return tests;
+	}
+}
+
+TEST(WorkStealingRunsEveryTestOnce, "SelfTest.Parallel")
+{
+	const auto tests = uneven_tests();
+	std::map<std::string, std::string> serial;
+	utest::Runner::run(tests, [&serial](const utest::Result& res)
+	{
+		serial[res.info->name] = std::string(utest::status_name(res.status)) + " " + res.failure.str();
+	});
+
+	std::map<std::string, std::string> parallel;
+	std::map<std::string, int> runs;
+	std::vector<unsigned> slow_workers;
+	utest::Run_Options options;
+	options.worker_count = 4;
+	const utest::Status status = utest::Runner::run_parallel(tests, [&](const utest::Result& res)
+	{
+		parallel[res.info->name] = std::string(utest::status_name(res.status)) + " " + res.failure.str();
+		++runs[res.info->name];
+		if (std::atoi(res.info->name + std::strlen("Uneven")) % 4 == 0)
+		{
+			slow_workers.push_back(res.worker);
+		}
+	}, options);
+
+	UASSERT(status == utest::Status::fail);
+	UASSERT_EQ(tests.size(), runs.size());
+	for (const auto& r : runs)
+	{
+		UASSERT_EQ(1, r.second);
+	}
+	UASSERT(serial == parallel);
+	// the idle workers took slow tests off the first worker's queue
+	std::sort(slow_workers.begin(), slow_workers.end());
+	UASSERT(std::unique(slow_workers.begin(), slow_workers.end()) - slow_workers.begin() > 1);
+}
+
+namespace
+{
+	// how many of the inner tests below are executing right now
+	std::atomic<int> g_running(0);
+
+	class Overlapping : public utest::Test
+	{
+		void execute_test() override
+		{
+			++g_running;
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			--g_running;
+		}
+	};
+
+	class Alone : public utest::Test
+	{
+		void execute_test() override
+		{
+			const int running = ++g_running;
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			--g_running;
+			UASSERT_EQ(1, running);
+		}
+	};
+}
+
+TEST(SerialTestsRunAlone, "SelfTest.Parallel")
+{
+	std::vector<const utest::Info*> tests;
+	for (int i = 0; i < 24; ++i)
+	{
+		const std::string name = "Mixed" + std::to_string(i);
+		tests.push_back(i % 6 == 0 ? named_info<Alone>(name, "SelfTest.Inner", utest::Test_Options().serial())
+			: named_info<Overlapping>(name));
+	}
+	utest::Run_Options options;
+	options.worker_count = 4;
+	size_t ran = 0;
+	const utest::Status status = utest::Runner::run_parallel(tests, [&ran](const utest::Result&) { ++ran; }, options);
+	UASSERT(status == utest::Status::pass);
+	UASSERT_EQ(tests.size(), ran);
+}
+
+TEST(ExclusiveGroupRunsInOrderOnOneWorker, "SelfTest.Parallel")
+{
+	std::vector<const utest::Info*> tests;
+	for (int i = 0; i < 12; ++i)
+	{
+		const std::string name = "Grouped" + std::to_string(i);
+		tests.push_back(i % 2 == 0 ? named_info<Overlapping>(name, "SelfTest.Inner", utest::Test_Options().exclusive("chain"))
+			: named_info<Overlapping>(name));
+	}
+	utest::Run_Options options;
+	options.worker_count = 4;
+	std::vector<utest::Result> chain;
+	utest::Runner::run_parallel(tests, [&chain](const utest::Result& res)
+	{
+		if (res.info->options.concurrency == utest::Concurrency::exclusive)
+		{
+			chain.push_back(res);
+		}
+	}, options);
+
+	UASSERT_EQ(size_t(6), chain.size());
+	std::sort(chain.begin(), chain.end(), [](const utest::Result& a, const utest::Result& b) { return a.started < b.started; });
+	for (size_t i = 0; i < chain.size(); ++i)
+	{
+		UASSERT_EQ("Grouped" + std::to_string(i * 2), std::string(chain[i].info->name));
+		UASSERT_EQ(chain[0].worker, chain[i].worker);
+		if (i > 0)
+		{
+			UASSERT(chain[i].started >= chain[i - 1].started + chain[i - 1].duration);
+		}
+	}
+}
+
+TEST(ShardsSplitTheTestsExactly, "SelfTest.Shards")
+{
+	std::vector<const utest::Info*> tests;
+	for (int i = 0; i < 100; ++i)
+	{
+		tests.push_back(named_info<Passer>("Sharded" + std::to_string(i)));
+	}
+	for (unsigned count = 1; count <= 5; ++count)
+	{
+		std::vector<int> owners(tests.size(), 0);
+		for (unsigned index = 0; index < count; ++index)
+		{
+			const utest::Shard shard(index, count);
+			for (size_t i = 0; i < tests.size(); ++i)
+			{
+				owners[i] += shard(tests[i]);
+			}
+		}
+		for (const int owned : owners)
+		{
+			UASSERT_EQ(1, owned);
+		}
+	}
+	// the split depends only on the name and category
+	UASSERT_EQ(utest::Shard::hash(tests[7]), utest::Shard::hash("Sharded7", "SelfTest.Inner"));
+}
+
+TEST(RegistryShardsSplitTheTestsExactly, "SelfTest.Shards")
+{
+	const auto& all = utest::Registry::get().tests();
+	utest::Duration_History history;
+	history.record(timed_result(all.front(), 1000000));
+	for (int balanced = 0; balanced < 2; ++balanced)
+	{
+		std::map<const utest::Info*, int> owners;
+		for (unsigned index = 0; index < 3; ++index)
+		{
+			const auto shard = balanced ? utest::Registry::get().shard(utest::Shard(index, 3), history.estimator())
+				: utest::Registry::get().shard(utest::Shard(index, 3));
+			// in registration order
+			UASSERT(std::is_sorted(shard.begin(), shard.end(), [&all](const utest::Info* a, const utest::Info* b)
+			{
+				return std::find(all.begin(), all.end(), a) < std::find(all.begin(), all.end(), b);
+			}));
+			for (const auto* ti : shard)
+			{
+				++owners[ti];
+			}
+		}
+		UASSERT_EQ(all.size(), owners.size());
+		for (const auto& owned : owners)
+		{
+			UASSERT_EQ(1, owned.second);
+		}
+	}
+}
+
+TEST(LateLinksKeepDeclarationOrder, "SelfTest.Registry")
+{
+	auto& registry = utest::Registry::get();
+	const std::vector<const utest::Info*> before = registry.tests();
+	// the tests of this file come back in the order they are declared
+	int line = 0;
+	for (const auto* ti : before)
+	{
+		if (std::string(ti->file) == __FILE__)
+		{
+			UASSERT(line < ti->line);
+			line = ti->line;
+		}
+	}
+	UASSERT(std::find(before.begin(), before.end(), &LateLinksKeepDeclarationOrder::s_info) != before.end());
+
+	// linked after the first sync, as by a library loaded at run time
+	struct Factory
+	{
+		static std::unique_ptr<utest::Test> create() { return std::make_unique<Passer>(); }
+	};
+	static std::deque<utest::Info> late;
+	for (const char* name : { "Late0", "Late1", "Late2" })
+	{
+		late.emplace_back(&Factory::create, nullptr, 0, 0, name, "SelfTest.Late", __FILE__, __LINE__);
+		utest::Registry::link(&late.back());
+	}
+	const auto& after = registry.tests();
+	UASSERT_EQ(before.size() + late.size(), after.size());
+	UASSERT(std::equal(before.begin(), before.end(), after.begin()));
+	for (size_t i = 0; i < late.size(); ++i)
+	{
+		UASSERT_EQ(&late[i], after[before.size() + i]);
+	}
+}
+
+namespace
+{
+	// fixtures of different sizes and alignments, each recording where it was constructed
+	const void* g_constructed_at = nullptr;
+
+	template<size_t Size, size_t Align>
+	class Sized : public utest::Test
+	{
+	public:
+		Sized() { g_constructed_at = this; }
+
+	private:
+		void execute_test() override
+		{
+			UASSERT_EQ(size_t(0), reinterpret_cast<size_t>(this) % Align);
+			std::memset(_payload, 0xAB, sizeof(_payload));
+		}
+
+		alignas(Align) unsigned char _payload[Size];
+	};
+
+	// an Info whose test the runner can construct in its arena, as the TEST macros produce
+	template<class Inner_Test>
+	const utest::Info* emplaced_info()
+	{
+		struct Factory
+		{
+			static std::unique_ptr<utest::Test> create() { return std::make_unique<Inner_Test>(); }
+			static utest::Test* emplace(void* storage) { return ::new (storage) Inner_Test(); }
+		};
+		static const utest::Info info(&Factory::create, &Factory::emplace, sizeof(Inner_Test), alignof(Inner_Test),
+			"Emplaced", "SelfTest.Inner", __FILE__, __LINE__);
+		return &info;
+	}
+
+	// runs the test through the arena on this thread and says where it was constructed
+	const void* run_in_arena(const utest::Info* ti)
+	{
+		utest::Result res;
+		utest::Runner::run(ti, res);
+		return res.status == utest::Status::pass ? g_constructed_at : nullptr;
+	}
+
+	class Runs_Nested : public utest::Test
+	{
+		void execute_test() override
+		{
+			UASSERT(utest::detail::test_arena().busy());
+			UASSERT_NOT_NULL(run_in_arena(emplaced_info<Sized<16, 8>>()));
+			UASSERT(utest::detail::test_arena().busy());
+		}
+	};
+}
+
+TEST(ArenaIsReusedAcrossSizesAndAlignments, "SelfTest.Arena")
+{
+	// this test runs in the arena itself, so a worker thread with a fresh arena does the work
+	bool reused = false;
+	std::thread worker([&reused]()
+	{
+		const void* small = run_in_arena(emplaced_info<Sized<8, 8>>());
+		const void* large = run_in_arena(emplaced_info<Sized<4096, 8>>());
+		const void* aligned = run_in_arena(emplaced_info<Sized<256, 128>>());
+		const void* small_again = run_in_arena(emplaced_info<Sized<8, 8>>());
+		const void* large_again = run_in_arena(emplaced_info<Sized<4096, 8>>());
+		// once the largest fixture has been seen, the buffer stays where it is
+		reused = small && large && aligned && small_again == large && large_again == large
+			&& !utest::detail::test_arena().busy();
+	});
+	worker.join();
+	UASSERT(reused);
+}
+
+TEST(NestedTestIsBuiltOutsideTheArena, "SelfTest.Arena")
+{
+	bool released = false;
+	std::thread worker([&released]()
+	{
+		// the nested test goes on the heap and leaves the arena to the test that holds it
+		const void* outer = run_in_arena(emplaced_info<Runs_Nested>());
+		released = outer != nullptr && !utest::detail::test_arena().busy();
+	});
+	worker.join();
+	UASSERT(released);
+}
+
+namespace
+{
+	std::vector<std::string> names_of(const std::vector<const utest::Info*>& tests)
+	{
+		std::vector<std::string> names;
+		for (const auto* ti : tests)
+		{
+			names.push_back(ti->name);
+		}
+		return names;
+	}
+}
+
+TEST(SelectorQueriesTheIndex, "SelfTest.Selectors")
+{
+	std::vector<const utest::Info*> tests;
+	tests.push_back(named_info<Passer>("Add", "Math"));
+	tests.push_back(named_info<Passer>("Parse", "Example"));
+	tests.push_back(named_info<Passer>("Sub", "Math.Integer"));
+	tests.push_back(named_info<Passer>("Plot", "Examples"));
+	tests.push_back(named_info<Passer>("Add", "Math.Float"));
+	tests.push_back(named_info<Passer>("Print", "Example.Tests"));
+	const utest::Registry_Index index(tests);
+
+	UASSERT_EQ(tests[0], index.find("Add"));
+	UASSERT_NULL(index.find("Missing"));
+	UASSERT(names_of(index.select(utest::Selector::name("Add"))) == std::vector<std::string>({ "Add", "Add" }));
+	UASSERT(index.select(utest::Selector::category("Math")) == std::vector<const utest::Info*>({ tests[0] }));
+	// whole components only, in registration order
+	UASSERT(index.select(utest::Selector::category_prefix("Math"))
+		== std::vector<const utest::Info*>({ tests[0], tests[2], tests[4] }));
+	UASSERT(index.select(utest::Selector::category_prefix("Example"))
+		== std::vector<const utest::Info*>({ tests[1], tests[5] }));
+	UASSERT(index.select(utest::Selector::glob("Example*")) == std::vector<const utest::Info*>({ tests[1], tests[3], tests[5] }));
+	UASSERT(index.select(utest::Selector::glob("Math.?????")) == std::vector<const utest::Info*>({ tests[4] }));
+	UASSERT(index.select(utest::Selector::glob("*.*")) == std::vector<const utest::Info*>({ tests[2], tests[4], tests[5] }));
+	UASSERT(index.select(utest::Selector::all()) == tests);
+
+	// as a filter predicate, a selector agrees with the index
+	for (const auto& selector : { utest::Selector::name("Add"), utest::Selector::category_prefix("Example"),
+		utest::Selector::glob("Math*") })
+	{
+		std::vector<const utest::Info*> filtered;
+		std::copy_if(tests.begin(), tests.end(), std::back_inserter(filtered), selector);
+		UASSERT(index.select(selector) == filtered);
+	}
+}
+
+namespace
+{
+	// ten tests, of which the third, sixth and ninth fail
+	std::vector<const utest::Info*> mostly_passing()
+	{
+		static std::vector<const utest::Info*> tests;
+		if (tests.empty())
+		{
+			for (int i = 1; i <= 10; ++i)
+			{
+				const std::string name = "Ordered" + std::to_string(i);
+				tests.push_back(i % 3 == 0 ? named_info<Number_Mismatch>(name) : named_info<Passer>(name));
+			}
+		}
+		return tests;
+	}
+}
+
+TEST(MaxFailuresCancelsTheRest, "SelfTest.FailFast")
+{
+	utest::Run_Options options;
+	options.max_failures = 2;
+	std::vector<std::string> ran;
+	const auto record = [&ran](const utest::Result& res) { ran.push_back(res.info->name); };
+	UASSERT(utest::Runner::run(mostly_passing(), record, options) == utest::Status::fail);
+	// the second failure is reported, and nothing is started after it
+	UASSERT_EQ(size_t(6), ran.size());
+	UASSERT_EQ(std::string("Ordered6"), ran.back());
+
+	ran.clear();
+	options.worker_count = 1;
+	UASSERT(utest::Runner::run_parallel(mostly_passing(), record, options) == utest::Status::fail);
+	UASSERT_EQ(size_t(6), ran.size());
+	UASSERT_EQ(std::string("Ordered6"), ran.back());
+}
+
+TEST(FailuresFirstReorders, "SelfTest.FailFast")
+{
+	// a first run finds the failures
+	utest::Failure_List failures;
+	utest::Run_Options options;
+	options.record_failures = &failures;
+	utest::Runner::run(mostly_passing(), [](const utest::Result&) {}, options);
+	UASSERT_EQ(size_t(3), failures.size());
+
+	// the next runs start with them and otherwise keep the registration order
+	const std::vector<std::string> expected({ "Ordered3", "Ordered6", "Ordered9", "Ordered1", "Ordered2", "Ordered4",
+		"Ordered5", "Ordered7", "Ordered8", "Ordered10" });
+	std::vector<std::string> ran;
+	const auto record = [&ran](const utest::Result& res) { ran.push_back(res.info->name); };
+	options = utest::Run_Options();
+	options.failures_first = &failures;
+	utest::Runner::run(mostly_passing(), record, options);
+	UASSERT(expected == ran);
+
+	ran.clear();
+	options.worker_count = 1;
+	utest::Runner::run_parallel(mostly_passing(), record, options);
+	UASSERT(expected == ran);
+
+	// a test leaves the list once it passes
+	utest::Result passed;
+	passed.info = mostly_passing()[2];
+	passed.status = utest::Status::pass;
+	failures.record(passed);
+	UASSERT_EQ(size_t(2), failures.size());
+	UASSERT_FALSE(failures.contains(mostly_passing()[2]));
+}
+
+namespace
+{
+	std::unique_ptr<utest::Test> make_passer()
+	{
+		return std::make_unique<Passer>();
+	}
+}
+
+TEST(ChangeSetMatchesTrailingComponents, "SelfTest.Changes")
+{
+	utest::Change_Set changes;
+	changes.add("tests/math.cpp");
+	changes.add("./src/io/read.cpp");
+	changes.add("/work/repo/src/net/socket.cpp");
+	changes.add("tests/math.cpp");
+	UASSERT_EQ(size_t(3), changes.size());
+
+	UASSERT(changes.changed("/work/repo/tests/math.cpp"));
+	UASSERT(changes.changed("../tests/math.cpp"));
+	UASSERT(changes.changed("tests/math.cpp"));
+	UASSERT(changes.changed("C:\\work\\repo\\tests\\math.cpp"));
+	UASSERT(changes.changed("/work/repo/src/io/read.cpp"));
+	// a relative __FILE__ against an absolute changed path
+	UASSERT(changes.changed("src/net/socket.cpp"));
+	UASSERT(changes.changed("net/socket.cpp"));
+
+	// whole components only
+	UASSERT_FALSE(changes.changed("/work/repo/tests/fastmath.cpp"));
+	UASSERT_FALSE(changes.changed("/work/repo/other/math.cpp"));
+	UASSERT_FALSE(changes.changed("/work/repo/src/io/read.cpp.orig"));
+	UASSERT_FALSE(changes.changed("ocket.cpp"));
+	UASSERT_FALSE(utest::Change_Set().changed("/work/repo/tests/math.cpp"));
+
+	const utest::Info declared(&make_passer, "Declared", "SelfTest.Inner", "/work/repo/tests/math.cpp", 1);
+	const utest::Info elsewhere(&make_passer, "Elsewhere", "SelfTest.Inner", "/work/repo/tests/string.cpp", 1);
+	UASSERT(changes(&declared));
+	UASSERT_FALSE(changes(&elsewhere));
+}
+
+TEST(ChangeSetFollowsDependencies, "SelfTest.Changes")
+{
+	const utest::Info math(&make_passer, "Math", "SelfTest.Inner", "/work/repo/tests/math_test.cpp", 1);
+	const utest::Info io_read(&make_passer, "IoRead", "SelfTest.Inner", "/work/repo/tests/io_read.cpp", 1);
+	const utest::Info io_write(&make_passer, "IoWrite", "SelfTest.Inner", "/work/repo/tests/io_write.cpp", 1);
+	const utest::Info strings(&make_passer, "Strings", "SelfTest.Inner", "/work/repo/tests/string_test.cpp", 1);
+
+	const Temp_File map("dependencies.txt");
+	const std::string text = "# test file: what it depends on\n"
+		"tests/math_test.cpp: src/math.cpp src/math.h\n"
+		"tests/io_*.cpp: src/io/*  # every io test\n"
+		"not a dependency line\n";
+	map.write(text.data(), text.size());
+
+	utest::Change_Set header;
+	UASSERT(header.load_dependencies(map.name));
+	header.add("src/math.h");
+	UASSERT(header(&math));
+	UASSERT_FALSE(header(&io_read));
+	UASSERT_FALSE(header(&strings));
+
+	utest::Change_Set io;
+	UASSERT(io.load_dependencies(map.name));
+	io.add("src/io/buffer.cpp");
+	UASSERT(io(&io_read));
+	UASSERT(io(&io_write));
+	UASSERT_FALSE(io(&math));
+
+	// declared in code, with a test file named by its trailing components
+	utest::Change_Set declared;
+	declared.depend("string_test.cpp", "src/text/*.cpp");
+	declared.add("src/text/utf8.cpp");
+	UASSERT(declared(&strings));
+	UASSERT_FALSE(declared(&math));
+	UASSERT_FALSE(utest::Change_Set().load_dependencies("self_test_missing.txt"));
+}
+
+namespace
+{
+	std::atomic<int> g_contexts_built(0);
+	std::atomic<int> g_contexts_live(0);
+
+	struct Counted_Context
+	{
+		Counted_Context()
+		{
+			++g_contexts_built;
+			++g_contexts_live;
+		}
+
+		~Counted_Context() { --g_contexts_live; }
+
+		std::atomic<int> uses{ 0 };
+	};
+
+	class Uses_Context : public utest::Suite_Test<Counted_Context>
+	{
+		void execute_test() override
+		{
+			++suite().uses;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	};
+
+	class Expects_No_Context : public utest::Test
+	{
+		void execute_test() override
+		{
+			UASSERT_EQ(0, g_contexts_live.load());
+		}
+	};
+
+	// the suite's tests, registered apart, and a test after them that needs the context to be gone
+	std::vector<const utest::Info*> suite_tests()
+	{
+		std::vector<const utest::Info*> tests;
+		for (int i = 0; i < 16; ++i)
+		{
+			tests.push_back(named_info<Uses_Context>("InSuite" + std::to_string(i)));
+			if (i == 7)
+			{
+				tests.push_back(named_info<Passer>("BetweenSuite"));
+			}
+		}
+		tests.push_back(named_info<Expects_No_Context>("AfterSuite", "SelfTest.Inner", utest::Test_Options().serial()));
+		return tests;
+	}
+}
+
+TEST(SuiteContextIsBuiltOnce, "SelfTest.Suites")
+{
+	g_contexts_built = 0;
+	const utest::Status status = utest::Runner::run(suite_tests(), [](const utest::Result&) {});
+	UASSERT(status == utest::Status::pass);
+	UASSERT_EQ(1, g_contexts_built.load());
+	UASSERT_EQ(0, g_contexts_live.load());
+}
+
+TEST(SuiteContextIsBuiltOncePerWorker, "SelfTest.Suites")
+{
+	g_contexts_built = 0;
+	std::vector<unsigned> workers;
+	utest::Run_Options options;
+	options.worker_count = 4;
+	const utest::Status status = utest::Runner::run_parallel(suite_tests(), [&workers](const utest::Result& res)
+	{
+		if (std::strncmp(res.info->name, "InSuite", 7) == 0)
+		{
+			workers.push_back(res.worker);
+		}
+	}, options);
+	UASSERT(status == utest::Status::pass);
+	UASSERT_EQ(size_t(16), workers.size());
+	std::sort(workers.begin(), workers.end());
+	const auto distinct = std::unique(workers.begin(), workers.end()) - workers.begin();
+	UASSERT_EQ(static_cast<int>(distinct), g_contexts_built.load());
+	UASSERT_EQ(0, g_contexts_live.load());
+}
+
+namespace
+{
+	int g_repeat_instances = 0;
+	int g_repeat_runs = 0;
+
+	// sleeps 2 ms longer on each run, and fails every third one
+	class Repeated : public utest::Test
+	{
+	public:
+		Repeated() { ++g_repeat_instances; }
+
+	private:
+		void execute_test() override
+		{
+			++g_repeat_runs;
+			std::this_thread::sleep_for(std::chrono::milliseconds(2 * g_repeat_runs));
+			UEXPECT(g_repeat_runs % 3 != 0);
+		}
+	};
+
+	class Counts_Instances : public utest::Test
+	{
+	public:
+		Counts_Instances() { ++g_repeat_instances; }
+
+	private:
+		void execute_test() override { ++g_repeat_runs; }
+	};
+
+	utest::Repeat_Stats repeat_counted(const utest::Repeat_Options& repeat)
+	{
+		g_repeat_instances = 0;
+		g_repeat_runs = 0;
+		return utest::Runner::repeat(inner_info<Counts_Instances>(), repeat);
+	}
+}
+
+TEST(RepeatRunsCountOrDuration, "SelfTest.Repeat")
+{
+	utest::Repeat_Options repeat;
+	UASSERT_EQ(1ULL, repeat_counted(repeat).runs);
+
+	repeat.count = 25;
+	size_t observed = 0;
+	const auto stats = utest::Runner::repeat(inner_info<Passer>(), repeat, [&observed](const utest::Result&) { ++observed; });
+	UASSERT_EQ(25ULL, stats.runs);
+	UASSERT_EQ(size_t(25), observed);
+	UASSERT_EQ(1.0, stats.pass_rate());
+
+	// whichever ends first
+	repeat.count = 3;
+	repeat.duration = std::chrono::milliseconds(60000);
+	UASSERT_EQ(3ULL, repeat_counted(repeat).runs);
+
+	repeat.count = 0;
+	repeat.duration = std::chrono::milliseconds(30);
+	const auto start = std::chrono::steady_clock::now();
+	const auto timed = utest::Runner::repeat(named_info<Napper>("Repeated"), repeat);
+	UASSERT(std::chrono::steady_clock::now() - start >= repeat.duration);
+	UASSERT(timed.runs >= 2);
+}
+
+TEST(RepeatWarmReusesTheInstance, "SelfTest.Repeat")
+{
+	utest::Repeat_Options repeat;
+	repeat.count = 5;
+	repeat.reuse_instance = true;
+	UASSERT_EQ(5ULL, repeat_counted(repeat).runs);
+	UASSERT_EQ(1, g_repeat_instances);
+	UASSERT_EQ(5, g_repeat_runs);
+
+	repeat.reuse_instance = false;
+	repeat.evict_bytes = 1 << 16;
+	UASSERT_EQ(5ULL, repeat_counted(repeat).runs);
+	UASSERT_EQ(5, g_repeat_instances);
+	UASSERT_EQ(5, g_repeat_runs);
+}
+
+TEST(RepeatStatsSummarizeTheRuns, "SelfTest.Repeat")
+{
+	g_repeat_runs = 0;
+	utest::Repeat_Options repeat;
+	repeat.count = 10;
+	const auto stats = utest::Runner::repeat(inner_info<Repeated>(), repeat);
+	UASSERT_EQ(10ULL, stats.runs);
+	UASSERT_EQ(7ULL, stats.passed);
+	UASSERT_EQ(0.7, stats.pass_rate());
+	UASSERT(stats.first_failure.status == utest::Status::fail);
+	UASSERT(stats.first_failure.test_duration >= std::chrono::milliseconds(6));
+
+	// the runs slept 2, 4, ... 20 ms, so whatever the scheduler added the ranks hold these bounds
+	const double ms = 1e6;
+	UASSERT(stats.min >= 2 * ms && stats.min <= stats.median);
+	UASSERT(stats.median >= 10 * ms && stats.median <= stats.p90);
+	UASSERT(stats.p90 >= 18 * ms && stats.p90 <= stats.p99);
+	// p99 of ten runs is the slowest
+	UASSERT_EQ(stats.max, stats.p99);
+	UASSERT(stats.max >= 20 * ms);
+	UASSERT(stats.mean >= 11 * ms && stats.mean <= stats.max);
+	UASSERT(stats.stddev > 0);
+
+	// bucket i counts runs of [2^i, 2^(i+1)) ns, so the fastest and slowest runs fix its ends
+	unsigned long long histogram_runs = 0;
+	size_t fastest = stats.histogram.size();
+	for (size_t i = 0; i < stats.histogram.size(); ++i)
+	{
+		histogram_runs += stats.histogram[i];
+		fastest = stats.histogram[i] && fastest == stats.histogram.size() ? i : fastest;
+	}
+	UASSERT_EQ(stats.runs, histogram_runs);
+	UASSERT(static_cast<double>(1ULL << fastest) <= stats.min && stats.min < static_cast<double>(2ULL << fastest));
+	const size_t slowest = stats.histogram.size() - 1;
+	UASSERT(static_cast<double>(1ULL << slowest) <= stats.max && stats.max < static_cast<double>(2ULL << slowest));
+}
+
+namespace
+{
+	const double inf = std::numeric_limits<double>::infinity();
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+
+	// every comparison fails, and carries on to the next one
+	class Near_Misses : public utest::Test
+	{
+		void execute_test() override
+		{
+			UEXPECT_NEAR(nan, nan, utest::Tolerance());
+			UEXPECT_NEAR(1.0, nan, utest::Tolerance().absolute(inf));
+			UEXPECT_NEAR(inf, std::numeric_limits<double>::max(), utest::Tolerance());
+			UEXPECT_NEAR(inf, -inf, utest::Tolerance().absolute(inf));
+			UEXPECT_NEAR(1.0, std::nextafter(1.0, 2.0), utest::Tolerance().ulps(0));
+			UEXPECT_NEAR(1.0f, 1.0f + 5 * std::numeric_limits<float>::epsilon(), utest::Tolerance());
+			UEXPECT_NEAR(0.0, 1e-300, utest::Tolerance().absolute(1e-301));
+		}
+	};
+
+	class Mem_Mismatches : public utest::Test
+	{
+		void execute_test() override
+		{
+			unsigned char expected[32];
+			for (unsigned char i = 0; i < sizeof(expected); ++i)
+			{
+				expected[i] = static_cast<unsigned char>(i * 17);
+			}
+			unsigned char actual[sizeof(expected)];
+			const size_t offsets[] = { 20, 2, 31 };
+			for (const size_t offset : offsets)
+			{
+				std::memcpy(actual, expected, sizeof(actual));
+				actual[offset] = 0xff;
+				UEXPECT_MEM_EQ(expected, actual, sizeof(expected));
+			}
+			UEXPECT_MEM_EQ(expected, actual, 31);
+			UEXPECT_MEM_EQ(expected, actual, 0);
+		}
+	};
+}
+
+TEST(NearHandlesTheEdgeCases, "SelfTest.Near")
+{
+	UASSERT_NEAR(0.0, -0.0, utest::Tolerance().ulps(0));
+	UASSERT_NEAR(inf, inf, utest::Tolerance().ulps(0));
+	UASSERT_NEAR(-inf, -inf, utest::Tolerance().ulps(0));
+	UASSERT_NEAR(-std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::denorm_min(), utest::Tolerance().ulps(2));
+	UASSERT_NEAR(1.0, 1.0 + 4 * std::numeric_limits<double>::epsilon(), utest::Tolerance());
+	UASSERT_NEAR(1.0f, 1.0f + 4 * std::numeric_limits<float>::epsilon(), utest::Tolerance());
+	UASSERT_NEAR(0.0, 1e-300, utest::Tolerance().ulps(0).absolute(1e-300));
+	UASSERT_NEAR(1e10, 1e10 + 1, utest::Tolerance().absolute(1));
+
+	const utest::Result res = run_inner<Near_Misses>();
+	UASSERT(res.status == utest::Status::fail);
+	std::vector<std::string> messages;
+	for (const auto& f : res.failures)
+	{
+		messages.push_back(f.str());
+	}
+	const std::vector<std::string> expected = {
+		"Expected [nan] saw [nan]: not a number, tolerance 4 ulps",
+		"Expected [1] saw [nan]: not a number, tolerance 4 ulps or inf",
+		"Expected [inf] saw [1.7976931348623157e+308]: infinity is only near itself, tolerance 4 ulps",
+		"Expected [inf] saw [-inf]: infinity is only near itself, tolerance 4 ulps or inf",
+		"Expected [1] saw [1.0000000000000002]: 1 ulps apart, tolerance 0 ulps",
+		"Expected [1] saw [1.0000006]: 5 ulps apart, tolerance 4 ulps",
+		"Expected [0] saw [1e-300]: 118622047889322841 ulps apart, tolerance 4 ulps or 1.0000000000000001e-301",
+	};
+	UASSERT(messages == expected);
+}
+
+TEST(MemEqShowsTheBytesAroundTheMismatch, "SelfTest.Near")
+{
+	const utest::Result res = run_inner<Mem_Mismatches>();
+	UASSERT(res.status == utest::Status::fail);
+	std::vector<std::string> messages;
+	for (const auto& f : res.failures)
+	{
+		messages.push_back(f.str());
+	}
+	// a window of 4 bytes either side, cut short at either end of the memory
+	const std::vector<std::string> expected = {
+		"Memory differs at offset 20 of 32: expected [... 10 21 32 43 54 65 76 87 98 ...] saw [... 10 21 32 43 ff 65 76 87 98 ...]",
+		"Memory differs at offset 2 of 32: expected [00 11 22 33 44 55 66 77 88 ...] saw [00 11 ff 33 44 55 66 77 88 ...]",
+		"Memory differs at offset 31 of 32: expected [... cb dc ed fe 0f] saw [... cb dc ed fe ff]",
+	};
+	UASSERT(messages == expected);
+}
+
+#if UTEST_CPP_COROUTINES
+namespace
+{
+	// an unregistered Info marked as a coroutine test, so run_async() multiplexes it
+	template<class Inner_Test>
+	const utest::Info* async_info(const std::string& name)
+	{
+		struct Factory
+		{
+			static std::unique_ptr<utest::Test> create() { return std::make_unique<Inner_Test>(); }
+		};
+		static std::deque<std::string> names;
+		static std::deque<utest::Info> infos;
+		names.push_back(name);
+		infos.emplace_back(&Factory::create, nullptr, 0, 0, names.back().c_str(), "SelfTest.Inner", __FILE__, __LINE__,
+			utest::Test_Options(), nullptr, utest::detail::suite_of<Inner_Test>(0), true);
+		return &infos.back();
+	}
+
+	std::atomic<int> g_past_assert(0);
+
+	utest::Async fails_deep_down()
+	{
+		co_await utest::yield();
+		UASSERT_EQ(3, 4);
+		++g_past_assert;
+	}
+
+	utest::Async awaits_the_failure()
+	{
+		co_await fails_deep_down();
+		++g_past_assert;
+	}
+
+	class Asserts_In_Nested_Coroutine : public utest::Async_Test
+	{
+		utest::Async execute_async_test() override
+		{
+			co_await awaits_the_failure();
+			++g_past_assert;
+		}
+	};
+
+	// the event is set by a thread of its own, and the test must carry on where it was suspended
+	class Waits_For_Other_Thread : public utest::Async_Test
+	{
+		utest::Async execute_async_test() override
+		{
+			utest::Async_Event done;
+			const auto before = std::this_thread::get_id();
+			std::thread setter([&done]()
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				done.set();
+			});
+			co_await done;
+			const auto after = std::this_thread::get_id();
+			setter.join();
+			UASSERT(done.is_set());
+			UASSERT(before == after);
+		}
+	};
+}
+
+TEST(AsyncAssertEndsTheTestFromANestedCoroutine, "SelfTest.Async")
+{
+	g_past_assert = 0;
+	const utest::Result res = run_inner<Asserts_In_Nested_Coroutine>();
+	UASSERT(res.status == utest::Status::fail);
+	UASSERT_EQ(std::string("Expected [3] saw [4]"), res.failure.str());
+	UASSERT_EQ(0, g_past_assert.load());
+
+	std::vector<const utest::Info*> tests;
+	for (int i = 0; i < 6; ++i)
+	{
+		tests.push_back(async_info<Asserts_In_Nested_Coroutine>("Nested" + std::to_string(i)));
+	}
+	utest::Run_Options options;
+	options.worker_count = 2;
+	size_t failed = 0;
+	const utest::Status status = utest::Runner::run_async(tests, [&failed](const utest::Result& r)
+	{
+		if (r.status == utest::Status::fail && r.failure.str() == "Expected [3] saw [4]")
+		{
+			++failed;
+		}
+	}, options);
+	UASSERT(status == utest::Status::fail);
+	UASSERT_EQ(tests.size(), failed);
+	UASSERT_EQ(0, g_past_assert.load());
+}
+
+TEST(AsyncEventIsSetFromAnotherThread, "SelfTest.Async")
+{
+	UASSERT(run_inner<Waits_For_Other_Thread>().status == utest::Status::pass);
+
+	std::vector<const utest::Info*> tests;
+	for (int i = 0; i < 8; ++i)
+	{
+		tests.push_back(async_info<Waits_For_Other_Thread>("Waiter" + std::to_string(i)));
+	}
+	utest::Run_Options options;
+	options.worker_count = 2;
+	size_t passed = 0;
+	const utest::Status status = utest::Runner::run_async(tests, [&passed](const utest::Result& r)
+	{
+		passed += r.status == utest::Status::pass;
+	}, options);
+	UASSERT(status == utest::Status::pass);
+	UASSERT_EQ(tests.size(), passed);
+}
+#endif
+
+namespace
+{
+	const std::chrono::milliseconds phase_sleep(3);
+
+	// each phase takes a known time, the teardown the longest
+	class Timed_Phases : public utest::Test
+	{
+		void pre_test() override { std::this_thread::sleep_for(phase_sleep); }
+		void execute_test() override { std::this_thread::sleep_for(phase_sleep * 2); }
+		void post_test() override { std::this_thread::sleep_for(phase_sleep * 3); }
+	};
+
+	class Fails_In_Setup : public utest::Test
+	{
+		void pre_test() override
+		{
+			std::this_thread::sleep_for(phase_sleep);
+			UASSERT_EQ(3, 4);
+		}
+		void execute_test() override { std::this_thread::sleep_for(phase_sleep); }
+	};
+
+	class Fails_In_Body : public utest::Test
+	{
+		void execute_test() override
+		{
+			std::this_thread::sleep_for(phase_sleep);
+			UASSERT_EQ(3, 4);
+		}
+	};
+
+	bool phases_add_up(const utest::Result& res)
+	{
+		return res.setup_duration + res.test_duration + res.teardown_duration <= res.duration;
+	}
+}
+
+TEST(PhasesAreTimedSeparately, "SelfTest.Phases")
+{
+	const utest::Result res = run_inner<Timed_Phases>(utest::Run_Options());
+	UASSERT(res.status == utest::Status::pass);
+	UASSERT(res.setup_duration >= phase_sleep);
+	UASSERT(res.test_duration >= phase_sleep * 2);
+	UASSERT(res.teardown_duration >= phase_sleep * 3);
+	UASSERT(phases_add_up(res));
+}
+
+TEST(FailureIsChargedToItsPhase, "SelfTest.Phases")
+{
+	// the body never runs, so its time stays zero
+	const utest::Result setup = run_inner<Fails_In_Setup>(utest::Run_Options());
+	UASSERT(setup.status == utest::Status::fail);
+	UASSERT(setup.setup_duration >= phase_sleep);
+	UASSERT_EQ(0LL, static_cast<long long>(setup.test_duration.count()));
+	UASSERT(phases_add_up(setup));
+
+	const utest::Result body = run_inner<Fails_In_Body>(utest::Run_Options());
+	UASSERT(body.status == utest::Status::fail);
+	UASSERT(body.test_duration >= phase_sleep);
+	UASSERT(body.setup_duration < phase_sleep);
+	UASSERT(phases_add_up(body));
+}
+
+#if UTEST_CPP_NO_EXCEPTIONS
+namespace
+{
+	// how far the phases of the inner tests below got before an assert jumped out of them
+	struct Phases
+	{
+		bool setup;
+		bool before_assert;
+		bool after_assert;
+		bool teardown;
+	} g_phases;
+
+	class Jumps_Out_Of_Body : public utest::Test
+	{
+		void post_test() override { g_phases.teardown = true; }
+
+		void execute_test() override
+		{
+			g_phases.before_assert = true;
+			UASSERT_EQ(1, 2);
+			g_phases.after_assert = true;
+		}
+	};
+
+	class Jumps_Out_Of_Setup : public utest::Test
+	{
+		void pre_test() override
+		{
+			g_phases.setup = true;
+			UASSERT_FAIL("setup failed");
+			g_phases.after_assert = true;
+		}
+
+		void post_test() override { g_phases.teardown = true; }
+
+		void execute_test() override { g_phases.before_assert = true; }
+	};
+}
+
+TEST(AssertJumpsOutOfTheBody, "SelfTest.NoExceptions")
+{
+	g_phases = Phases();
+	const utest::Result res = run_inner<Jumps_Out_Of_Body>();
+	UASSERT(res.status == utest::Status::fail);
+	UASSERT_EQ(std::string("Expected [1] saw [2]"), res.failure.str());
+	UASSERT_EQ(size_t(1), res.failures.size());
+	UASSERT(g_phases.before_assert);
+	UASSERT(!g_phases.after_assert);
+	UASSERT(g_phases.teardown);
+	// the inner test's abort point is gone, so this assert returns here rather than into it
+	UASSERT(utest::detail::current_abort_point() != nullptr);
+}
+
+TEST(AssertInSetupSkipsTheBody, "SelfTest.NoExceptions")
+{
+	g_phases = Phases();
+	const utest::Result res = run_inner<Jumps_Out_Of_Setup>();
+	UASSERT(res.status == utest::Status::fail);
+	UASSERT_EQ(std::string("setup failed"), res.failure.str());
+	UASSERT(g_phases.setup);
+	UASSERT(!g_phases.after_assert);
+	UASSERT(!g_phases.before_assert);
+	UASSERT(g_phases.teardown);
+}
+
+TEST(ExpectCarriesOnWithoutExceptions, "SelfTest.NoExceptions")
+{
+	const utest::Result res = run_inner<Multi_Line_Mismatch>();
+	UASSERT(res.status == utest::Status::fail);
+	UASSERT_EQ(size_t(1), res.failures.size());
+	// the runner recovers from the jump and goes on to the next test
+	UASSERT(run_inner<Passer>().status == utest::Status::pass);
+}
+#endif
+
+namespace
+{
+	// built with optimization whatever the rest of the file is built with: "+m,r" read back garbage at -O2
+#if defined(__GNUC__) && !defined(__clang__)
+	__attribute__((noinline, optimize("O2")))
+#endif
+	unsigned long long sum_through_barrier(const unsigned count)
+	{
+		unsigned long long sum = 0;
+		for (unsigned i = 1; i <= count; ++i)
+		{
+			sum += i;
+			utest::do_not_optimize(sum);
+		}
+		return sum;
+	}
+
+	struct Pair
+	{
+		int first;
+		double second;
+	};
+
+#if defined(__GNUC__) && !defined(__clang__)
+	__attribute__((noinline, optimize("O2")))
+#endif
+	Pair pair_through_barrier(Pair pair)
+	{
+		utest::do_not_optimize(pair);
+		pair.first += 1;
+		utest::do_not_optimize(pair);
+		return pair;
+	}
+
+	// what BENCHMARK declares, without registering it
+	class Adds_Numbers : public utest::Benchmark
+	{
+		void execute_batch(const unsigned long long iterations) override
+		{
+			for (unsigned long long i = 0; i < iterations; ++i)
+			{
+				_sum += i;
+				utest::do_not_optimize(_sum);
+			}
+		}
+
+		unsigned long long _sum = 0;
+	};
+
+	// keeps the run short, and puts the options back for anything else that benchmarks
+	struct Quick_Benchmarks
+	{
+		Quick_Benchmarks()
+			: saved(utest::Benchmark::options())
+		{
+			auto& opts = utest::Benchmark::options();
+			opts.warmup_time = std::chrono::milliseconds(1);
+			opts.measure_time = std::chrono::milliseconds(5);
+			opts.sample_count = 10;
+		}
+
+		~Quick_Benchmarks() { utest::Benchmark::options() = saved; }
+
+		const utest::Benchmark_Options saved;
+	};
+}
+
+TEST(DoNotOptimizeKeepsTheValue, "SelfTest.Benchmarks")
+{
+	UASSERT_EQ(500500ULL, sum_through_barrier(1000));
+	const Pair pair = pair_through_barrier(Pair{ 41, 0.5 });
+	UASSERT_EQ(42, pair.first);
+	UASSERT_EQ(0.5, pair.second);
+}
+
+TEST(BenchmarkFillsItsStats, "SelfTest.Benchmarks")
+{
+	const Quick_Benchmarks quick;
+	const utest::Result res = run_inner<Adds_Numbers>(utest::Run_Options());
+	UASSERT(res.status == utest::Status::pass);
+	const utest::Benchmark_Stats& b = res.benchmark;
+	UASSERT_EQ(10u, b.samples);
+	UASSERT(b.iterations > 0);
+	UASSERT(b.min > 0);
+	UASSERT(b.min <= b.median);
+	UASSERT(b.median <= b.p99);
+	UASSERT(b.min <= b.mean && b.mean <= b.p99);
+	UASSERT(b.stddev >= 0);
+
+	// an ordinary test is no benchmark
+	UASSERT_EQ(0u, run_inner<Passer>().benchmark.samples);
+}
+
+#if UTEST_CPP_PERF_COUNTERS
+namespace
+{
+	void spin()
+	{
+		unsigned long long sum = 0;
+		for (unsigned i = 0; i < 100000; ++i)
+		{
+			sum += i * i;
+			utest::do_not_optimize(sum);
+		}
+	}
+
+	class Busy_Passer : public utest::Test
+	{
+		void execute_test() override
+		{
+			spin();
+		}
+	};
+
+	class Busy_Failer : public utest::Test
+	{
+		void execute_test() override
+		{
+			spin();
+			UASSERT_EQ(3, 4);
+		}
+	};
+
+	// filled in when the kernel lets this thread count, and cleanly empty when it doesn't
+	bool counted(const utest::Counter_Stats& counters, const bool available)
+	{
+		if (!available)
+		{
+			return !counters.tracked && counters.cycles == 0 && counters.instructions == 0
+				&& counters.branch_misses == 0 && counters.cache_misses == 0;
+		}
+		return counters.tracked && counters.cycles + counters.instructions > 0;
+	}
+}
+
+TEST(CountersCoverPassingAndFailingTests, "SelfTest.Counters")
+{
+	utest::detail::Counter_Sample sample;
+	const bool available = utest::detail::sample_counters(sample);
+
+	const utest::Result passed = run_inner<Busy_Passer>(utest::Run_Options());
+	UASSERT(passed.status == utest::Status::pass);
+	UASSERT(counted(passed.counters, available));
+
+	// the assert leaves the body early, and the counters are still read
+	const utest::Result failed = run_inner<Busy_Failer>(utest::Run_Options());
+	UASSERT(failed.status == utest::Status::fail);
+	UASSERT(counted(failed.counters, available));
+}
+#endif
+
+#if UTEST_CPP_TRACK_ALLOCATIONS
+namespace
+{
+	struct Allocating_Context
+	{
+		Allocating_Context()
+			: values(100, 7)
+			, name("a suite context that is long enough to live on the heap")
+		{}
+
+		std::vector<int> values;
+		std::string name;
+	};
+
+	class Suite_User : public utest::Suite_Test<Allocating_Context>
+	{
+		void execute_test() override
+		{
+			UASSERT_EQ(size_t(100), suite().values.size());
+		}
+	};
+
+	class Leaker : public utest::Test
+	{
+		void execute_test() override
+		{
+			utest::do_not_optimize(new int(1));
+		}
+	};
+
+	// what the body stores in its fixture is freed when the fixture is destroyed, after the run
+	struct Container_Fixture : public utest::Test
+	{
+		std::vector<int> values;
+		std::unique_ptr<std::string> name;
+	};
+
+	class Fills_Fixture : public Container_Fixture
+	{
+		void execute_test() override
+		{
+			values.resize(100);
+			name.reset(new std::string("a name that is long enough to live on the heap"));
+		}
+	};
+
+	utest::Run_Options leak_checked()
+	{
+		utest::Run_Options options;
+		options.fail_on_leak = true;
+		return options;
+	}
+}
+
+TEST(SuiteContextIsNotALeak, "SelfTest.Allocations")
+{
+	const utest::Result res = run_inner<Suite_User>(leak_checked());
+	UASSERT(res.status == utest::Status::pass);
+	UASSERT_EQ(0ULL, res.allocations.leaked_count);
+	UASSERT_EQ(0ULL, res.allocations.count);
+}
+
+TEST(ParallelSuiteContextIsNotALeak, "SelfTest.Allocations")
+{
+	const std::vector<const utest::Info*> tests(8, inner_info<Suite_User>());
+	utest::Run_Options options = leak_checked();
+	options.worker_count = 4;
+	unsigned leaked = 0;
+	const utest::Status status = utest::Runner::run_parallel(tests, [&leaked](const utest::Result& res)
+	{
+		leaked += res.allocations.leaked_count > 0;
+	}, options);
+	UASSERT(status == utest::Status::pass);
+	UASSERT_EQ(0u, leaked);
+}
+
+TEST(FailedExpectationIsNotALeak, "SelfTest.Allocations")
+{
+	const utest::Result res = run_inner<Number_Mismatch>(leak_checked());
+	UASSERT(res.status == utest::Status::fail);
+	UASSERT_EQ(size_t(1), res.failures.size());
+	UASSERT_EQ(0ULL, res.allocations.leaked_count);
+}
+
+#if !UTEST_CPP_NO_EXCEPTIONS
+// without exceptions the jump out of the body skips its destructors, so its strings do leak
+TEST(FailedAssertIsNotALeak, "SelfTest.Allocations")
+{
+	const utest::Result res = run_inner<View_Mismatch>(leak_checked());
+	UASSERT(res.status == utest::Status::fail);
+	UASSERT_EQ(0ULL, res.allocations.leaked_count);
+}
+#endif
+
+TEST(FixtureContainerIsNotALeak, "SelfTest.Allocations")
+{
+	const utest::Result res = run_inner<Fills_Fixture>(leak_checked());
+	UASSERT(res.status == utest::Status::pass);
+	UASSERT_EQ(0ULL, res.allocations.leaked_count);
+	UASSERT(res.allocations.count >= 2);
+}
+
+TEST(IsolatedFixtureContainerIsNotALeak, "SelfTest.Allocations")
+{
+	unsigned leaked = 0;
+	const utest::Status status = utest::Runner::run_isolated(std::vector<const utest::Info*>(2, inner_info<Fills_Fixture>()),
+		[&leaked](const utest::Result& res)
+	{
+		leaked += res.allocations.leaked_count > 0;
+	}, leak_checked());
+	UASSERT(status == utest::Status::pass);
+	UASSERT_EQ(0u, leaked);
+}
+
+TEST(LeakIsStillReported, "SelfTest.Allocations")
+{
+	const utest::Result res = run_inner<Leaker>(leak_checked());
+	UASSERT(res.status == utest::Status::fail);
+	UASSERT_EQ(1ULL, res.allocations.leaked_count);
+}
+
+// each case grows the vector the last one filled, so a case frees what an earlier one allocated
+TEST_P_F(FillsFixtureEachCase, Container_Fixture, "SelfTest.Allocations", utest::range(1, 7))
+{
+	values.resize(values.size() + 100 * static_cast<size_t>(param()));
+	name.reset(new std::string("a name that is long enough to live on the heap"));
+}
+
+namespace
+{
+	// every result of the run, and how many of them leaked
+	struct Leak_Count
+	{
+		utest::Status status;
+		size_t results;
+		size_t leaked;
+	};
+
+	template<class Run>
+	Leak_Count count_leaks(const Run& run)
+	{
+		Leak_Count count{ utest::Status::not_run, 0, 0 };
+		std::mutex mutex;
+		count.status = run([&count, &mutex](const utest::Result& res)
+		{
+			const std::lock_guard<std::mutex> lock(mutex);
+			++count.results;
+			count.leaked += res.allocations.leaked_count > 0;
+		});
+		return count;
+	}
+}
+
+TEST(ParallelFixtureContainerIsNotALeak, "SelfTest.Allocations")
+{
+	std::vector<const utest::Info*> tests(8, inner_info<Fills_Fixture>());
+	tests.push_back(&FillsFixtureEachCase::s_info);
+	utest::Run_Options options = leak_checked();
+	options.worker_count = 4;
+	options.case_batch = 2;
+	const Leak_Count parallel = count_leaks([&](const utest::Runner::Observer_Func& observer)
+	{
+		return utest::Runner::run_parallel(tests, observer, options);
+	});
+	UASSERT(parallel.status == utest::Status::pass);
+	UASSERT_EQ(size_t(14), parallel.results);
+	UASSERT_EQ(size_t(0), parallel.leaked);
+
+	const Leak_Count leaker = count_leaks([&](const utest::Runner::Observer_Func& observer)
+	{
+		return utest::Runner::run_parallel(std::vector<const utest::Info*>(4, inner_info<Leaker>()), observer, options);
+	});
+	UASSERT(leaker.status == utest::Status::fail);
+	UASSERT_EQ(size_t(4), leaker.leaked);
+}
+
+TEST(ParameterizedFixtureContainerIsNotALeak, "SelfTest.Allocations")
+{
+	const std::vector<const utest::Info*> tests(1, &FillsFixtureEachCase::s_info);
+	const Leak_Count in_order = count_leaks([&](const utest::Runner::Observer_Func& observer)
+	{
+		return utest::Runner::run(tests, observer, leak_checked());
+	});
+	UASSERT(in_order.status == utest::Status::pass);
+	UASSERT_EQ(size_t(6), in_order.results);
+	UASSERT_EQ(size_t(0), in_order.leaked);
+}
+
+TEST(WarmRepeatFixtureContainerIsNotALeak, "SelfTest.Allocations")
+{
+	utest::Repeat_Options repeat;
+	repeat.count = 5;
+	repeat.reuse_instance = true;
+	size_t leaked = 0;
+	const auto warm = utest::Runner::repeat(inner_info<Fills_Fixture>(), repeat, [&leaked](const utest::Result& res)
+	{
+		leaked += res.allocations.leaked_count > 0;
+	}, leak_checked());
+	UASSERT_EQ(5ULL, warm.passed);
+	UASSERT_EQ(size_t(0), leaked);
+
+	const auto leaking = utest::Runner::repeat(inner_info<Leaker>(), repeat, leak_checked());
+	UASSERT_EQ(5ULL, leaking.runs);
+	UASSERT_EQ(0ULL, leaking.passed);
+	UASSERT_EQ(1ULL, leaking.first_failure.allocations.leaked_count);
+}
+#endif
+
+TEST(FailureOutlivesViewOperands, "SelfTest.Failure")
+{
+	const utest::Result res = run_inner<View_Mismatch>();
+	UASSERT(res.status == utest::Status::fail);
+	UASSERT_EQ(std::string("Expected [expected text that is long enough to live on the heap] saw "
+		"[actual text that is long enough to live on the heap too]"), res.failure.str());
+}
+
+#if __cplusplus >= 201703L
+TEST(FailureOutlivesStringViewOperands, "SelfTest.Failure")
+{
+	const utest::Result res = run_inner<String_View_Mismatch>();
+	UASSERT(res.status == utest::Status::fail);
+	UASSERT_EQ(std::string("Expected [expected text that is long enough to live on the heap] saw "
+		"[actual text that is long enough to live on the heap too]"), res.failure.str());
+}
+#endif
+
+TEST(FailureFormatsNumbersLater, "SelfTest.Failure")
+{
+	const utest::Result res = run_inner<Number_Mismatch>();
+	UASSERT(res.status == utest::Status::fail);
+	UASSERT_EQ(std::string("Expected [3] saw [4]"), res.failure.str());
+}
+
+// the watchdog names each overrunning test on stderr as well
+TEST(InProcessTimeoutIsReported, "SelfTest.Timeouts")
+{
+	utest::Run_Options options;
+	options.timeout = std::chrono::milliseconds(1);
+	utest::Result res;
+	UASSERT(utest::Runner::run(named_info<Napper>("Overruns"), res, options) == utest::Status::timeout);
+	UASSERT(res.status == utest::Status::timeout);
+	UASSERT_EQ(size_t(1), res.failures.size());
+	UASSERT(contains(res.failure.str(), " ms (limit 1 ms)"));
+	UASSERT_EQ(size_t(0), res.failure.str().find("timed out after "));
+	UASSERT(res.duration >= std::chrono::milliseconds(10));
+
+	options.timeout = std::chrono::milliseconds(10000);
+	utest::Result quick;
+	UASSERT(utest::Runner::run(named_info<Napper>("InTime"), quick, options) == utest::Status::pass);
+}
+
+TEST(TestTimeLimitOverridesTheRun, "SelfTest.Timeouts")
+{
+	utest::Run_Options options;
+	utest::Result own;
+	utest::Runner::run(named_info<Napper>("OwnLimit", "SelfTest.Inner",
+		utest::Test_Options().timeout(std::chrono::milliseconds(1))), own, options);
+	UASSERT(own.status == utest::Status::timeout);
+
+	options.timeout = std::chrono::milliseconds(1);
+	utest::Result generous;
+	utest::Runner::run(named_info<Napper>("GenerousLimit", "SelfTest.Inner",
+		utest::Test_Options().timeout(std::chrono::milliseconds(10000))), generous, options);
+	UASSERT(generous.status == utest::Status::pass);
+
+	utest::Result failed;
+	utest::Runner::run(named_info<Number_Mismatch>("FailsInTime", "SelfTest.Inner",
+		utest::Test_Options().timeout(std::chrono::milliseconds(10000))), failed, options);
+	UASSERT(failed.status == utest::Status::fail);
+}
+
+#if UTEST_CPP_PROCESS_ISOLATION
+namespace
+{
+	class Sleeper : public utest::Test
+	{
+		void execute_test() override
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		}
+	};
+
+	// counts the lines of stderr, from this process and its workers, that contain part
+	template<class Function>
+	size_t count_stderr_lines(const char* part, const Function& f)
+	{
+		std::fflush(stderr);
+		std::FILE* capture = std::tmpfile();
+		const int saved = ::dup(2);
+		::dup2(::fileno(capture), 2);
+		f();
+		std::fflush(stderr);
+		::dup2(saved, 2);
+		::close(saved);
+
+		size_t count = 0;
+		char line[512];
+		std::rewind(capture);
+		while (std::fgets(line, sizeof(line), capture))
+		{
+			count += std::strstr(line, part) != nullptr;
+		}
+		std::fclose(capture);
+		return count;
+	}
+}
+
+namespace
+{
+	class Segfaulter : public utest::Test
+	{
+		void execute_test() override
+		{
+			std::raise(SIGSEGV);
+		}
+	};
+
+	class Aborter : public utest::Test
+	{
+		void execute_test() override
+		{
+			std::abort();
+		}
+	};
+
+	class Exiter : public utest::Test
+	{
+		void execute_test() override
+		{
+			std::exit(0);
+		}
+	};
+}
+
+TEST(IsolatedCrashesFailOnlyTheirTest, "SelfTest.Isolation")
+{
+	std::vector<const utest::Info*> tests;
+	tests.push_back(named_info<Segfaulter>("Segfaults"));
+	tests.push_back(named_info<Passer>("AfterSegfault"));
+	tests.push_back(named_info<Aborter>("Aborts"));
+	tests.push_back(named_info<Passer>("AfterAbort"));
+	tests.push_back(named_info<Exiter>("Exits"));
+	tests.push_back(named_info<Passer>("AfterExit"));
+	std::map<std::string, utest::Result> results;
+	utest::Run_Options options;
+	options.worker_count = 1;
+	utest::Status status = utest::Status::not_run;
+	// the dying workers may have something to say on stderr
+	count_stderr_lines("", [&]()
+	{
+		status = utest::Runner::run_isolated(tests, [&results](const utest::Result& res) { results[res.info->name] = res; },
+			options);
+	});
+
+	UASSERT(status == utest::Status::fail);
+	UASSERT_EQ(tests.size(), results.size());
+	UASSERT(results["Segfaults"].status == utest::Status::fail);
+	UASSERT(contains(results["Segfaults"].failure.str(), "worker process"));
+	UASSERT(results["Aborts"].status == utest::Status::fail);
+	UASSERT(contains(results["Aborts"].failure.str(), ("terminated by signal " + std::to_string(SIGABRT)).c_str()));
+	// exiting cleanly in the middle of a test is still a crash
+	UASSERT(results["Exits"].status == utest::Status::fail);
+	// with code 0, unless a leak checker had its say on the way out
+	UASSERT(contains(results["Exits"].failure.str(), "worker process exited with code"));
+	UASSERT(results["AfterSegfault"].status == utest::Status::pass);
+	UASSERT(results["AfterAbort"].status == utest::Status::pass);
+	UASSERT(results["AfterExit"].status == utest::Status::pass);
+}
+
+// the parent's watchdog thread is running by now, and a worker exiting must not wait for its copy
+TEST(IsolatedExitWithWatchdogRunning, "SelfTest.Timeouts")
+{
+	utest::Run_Options in_process;
+	in_process.timeout = std::chrono::milliseconds(10000);
+	utest::Result started;
+	utest::Runner::run(named_info<Passer>("StartsWatchdog"), started, in_process);
+
+	utest::Run_Options options;
+	options.worker_count = 1;
+	options.timeout = std::chrono::milliseconds(5000);
+	utest::Result exited;
+	count_stderr_lines("", [&]()
+	{
+		utest::Runner::run_isolated(std::vector<const utest::Info*>(1, named_info<Exiter>("ExitsWorker")),
+			[&exited](const utest::Result& res) { exited = res; }, options);
+	});
+	UASSERT(exited.status == utest::Status::fail);
+	UASSERT(contains(exited.failure.str(), "worker process exited with code"));
+}
+
+TEST(IsolatedTimeoutIsReportedOnce, "SelfTest.Timeouts")
+{
+	utest::Run_Options options;
+	options.timeout = std::chrono::milliseconds(100);
+	utest::Status status = utest::Status::not_run;
+	const size_t warnings = count_stderr_lines("over its 100 ms time limit", [&]()
+	{
+		status = utest::Runner::run_isolated(std::vector<const utest::Info*>(1, inner_info<Sleeper>()),
+			[](const utest::Result&) {}, options);
+	});
+	UASSERT(status != utest::Status::pass);
+	UASSERT_EQ(size_t(1), warnings);
+}
+#endif
+
+TEST(JunitStreamsEachTestcase, "SelfTest.Reporters")
+{
+	std::ostringstream os;
+	{
+		// with no flush interval each result is written out as soon as it is reported
+		utest::Junit_Reporter junit(os, std::chrono::milliseconds(0));
+		junit(run_inner<Passer>(utest::Run_Options()));
+		UASSERT_EQ(size_t(0), os.str().find("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n<testsuite name=\"utest\">\n"
+			"<testcase classname=\"SelfTest.Inner\" name=\"Inner\" file=\""));
+		UASSERT(!contains(os.str(), "</testsuite>"));
+
+		junit(run_inner<Multi_Line_Mismatch>(utest::Run_Options()));
+		UASSERT(contains(os.str(), "</testcase>\n"));
+		utest::Result skipped;
+		skipped.info = inner_info<Passer>();
+		junit(skipped);
+	}
+	const std::string xml = os.str();
+	UASSERT(contains(xml, "<failure type=\"fail\" message=\"Expected [first&#9;line&#10;second] saw [first&#9;line&#13;&#10;second]\""));
+	// element text keeps its line breaks
+	UASSERT(contains(xml, "): Expected [first\tline\nsecond]"));
+	UASSERT(contains(xml, "<skipped/>\n</testcase>\n</testsuite>\n</testsuites>\n"));
+	UASSERT_EQ(size_t(xml.size() - std::strlen("</testsuite>\n</testsuites>\n")), xml.find("</testsuite>"));
+}
+
+TEST(DurationHistoryRoundTrips, "SelfTest.History")
+{
+	const utest::Info* quick = named_info<Passer>("Quick");
+	const utest::Info* slow = named_info<Passer>("Slow");
+	const Temp_File file("history.dur");
+	{
+		utest::Duration_History history;
+		history.record(timed_result(quick, 1000));
+		history.record(timed_result(slow, 5000000));
+		UASSERT(history.save(file.name));
+	}
+	utest::Duration_History loaded;
+	UASSERT(loaded.load(file.name));
+	UASSERT_EQ(size_t(2), loaded.size());
+	UASSERT_EQ(1000LL, static_cast<long long>(loaded.estimate(quick).count()));
+	UASSERT_EQ(5000000LL, static_cast<long long>(loaded.estimate(slow).count()));
+	UASSERT_EQ(0LL, static_cast<long long>(loaded.estimate(named_info<Passer>("Unknown")).count()));
+}
+
+TEST(DurationHistorySmoothsSamples, "SelfTest.History")
+{
+	const utest::Info* ti = named_info<Passer>("Smoothed");
+	utest::Duration_History history;
+	history.record(timed_result(ti, 1000));
+	history.record(timed_result(ti, 3000));
+	UASSERT_EQ(2000LL, static_cast<long long>(history.estimate(ti).count()));
+
+	history.smoothing = 0.25;
+	history.record(timed_result(ti, 6000));
+	UASSERT_EQ(3000LL, static_cast<long long>(history.estimate(ti).count()));
+
+	// results that say nothing about the duration are left out
+	utest::Result not_run = timed_result(ti, 100000);
+	not_run.status = utest::Status::not_run;
+	history.record(not_run);
+	UASSERT_EQ(3000LL, static_cast<long long>(history.estimate(ti).count()));
+}
+
+TEST(DurationHistoryRejectsCorruptFiles, "SelfTest.History")
+{
+	const Temp_File file("corrupt.dur");
+	utest::Duration_History history;
+	history.record(timed_result(named_info<Passer>("Kept"), 1000));
+
+	// the magic and a count far beyond what follows
+	struct
+	{
+		char magic[8];
+		unsigned long long count;
+		unsigned long long record[2];
+	} huge = { { 'U', 'T', 'D', 'U', 'R', '0', '0', '1' }, 1ULL << 60, { 1, 2 } };
+	file.write(&huge, sizeof(huge));
+	UASSERT_FALSE(history.load(file.name));
+
+	// one record announced and only half of it written
+	huge.count = 1;
+	file.write(&huge, sizeof(huge) - sizeof(unsigned long long));
+	UASSERT_FALSE(history.load(file.name));
+
+	file.write("UTDUR", 5);
+	UASSERT_FALSE(history.load(file.name));
+	UASSERT_FALSE(history.load("self_test_missing.dur"));
+	// a failed load keeps what the history had
+	UASSERT_EQ(size_t(1), history.size());
+}
+
+TEST(DurationHistorySchedulesLongestFirst, "SelfTest.History")
+{
+	std::vector<const utest::Info*> tests;
+	tests.push_back(named_info<Passer>("Short"));
+	tests.push_back(named_info<Passer>("Long"));
+	tests.push_back(named_info<Passer>("Unknown"));
+	tests.push_back(named_info<Passer>("Medium"));
+	utest::Duration_History history;
+	history.record(timed_result(tests[0], 1000));
+	history.record(timed_result(tests[1], 9000));
+	history.record(timed_result(tests[3], 6000));
+
+	// a single worker runs its queue in schedule order; the unknown test is costed at the mean
+	std::vector<std::string> order;
+	utest::Run_Options options;
+	options.worker_count = 1;
+	options.schedule_history = &history;
+	utest::Runner::run_parallel(tests, [&order](const utest::Result& res) { order.push_back(res.info->name); }, options);
+	UASSERT_EQ(size_t(4), order.size());
+	UASSERT_EQ(std::string("Long"), order[0]);
+	UASSERT_EQ(std::string("Medium"), order[1]);
+	UASSERT_EQ(std::string("Unknown"), order[2]);
+	UASSERT_EQ(std::string("Short"), order[3]);
+}
+
+namespace
+{
+	// a passing benchmark result as the runner would conclude it
+	utest::Result benchmark_result(const double median_ns)
+	{
+		utest::Result res;
+		res.info = inner_info<Passer>();
+		res.status = utest::Status::pass;
+		res.benchmark.iterations = 1000;
+		res.benchmark.samples = 20;
+		res.benchmark.min = median_ns;
+		res.benchmark.median = median_ns;
+		res.benchmark.mean = median_ns;
+		res.benchmark.p99 = median_ns;
+		res.benchmark.stddev = 1;
+		return res;
+	}
+}
+
+TEST(BaselineComparesBeforeRecording, "SelfTest.Baselines")
+{
+	utest::Baseline baseline;
+	baseline.record(benchmark_result(100));
+	utest::Run_Options options;
+	options.compare_baseline = &baseline;
+	options.record_baseline = &baseline;
+
+	utest::Result slower = benchmark_result(200);
+	UASSERT(utest::Runner::conclude(slower, options) == utest::Status::regressed);
+	// the regressed numbers are not the new baseline
+	utest::Benchmark_Stats stored;
+	UASSERT(baseline.find(inner_info<Passer>(), stored));
+	UASSERT_EQ(100.0, stored.median);
+
+	utest::Result same = benchmark_result(100);
+	UASSERT(utest::Runner::conclude(same, options) == utest::Status::pass);
+}
+
+TEST_P(FloatingPointRange, "SelfTest.Params", utest::range(0.0, 1.0, 0.1))
+{
+	UASSERT(param() < 1.0);
+}
+
+TEST(RangeCountsEveryStep, "SelfTest.Params")
+{
+	UASSERT_EQ(size_t(10), FloatingPointRange::case_count());
+	UASSERT_EQ(size_t(10), utest::range(0.0f, 1.0f, 0.1f).size());
+	UASSERT_EQ(size_t(4), utest::range(0, 10, 3).size());
+	UASSERT_EQ(size_t(4), utest::range(0u, 10u, 3u).size());
+	UASSERT_EQ(size_t(0), utest::range(10, 0).size());
+}
+
+TEST(RangeCountsDown, "SelfTest.Params")
+{
+	const auto down = utest::range(10, 0, -3);
+	UASSERT_EQ(size_t(4), down.size());
+	UASSERT_EQ(1, down[3]);
+	UASSERT_EQ(size_t(4), utest::range(1.0, 0.0, -0.25).size());
+	UASSERT_EQ(size_t(0), utest::range(0, 10, -1).size());
+}
+
+namespace
+{
+	// a table built afresh by every call, which param() must not read after it is gone
+	std::vector<std::string> temporary_table()
+	{
+		return { "a first entry that is long enough to live on the heap", "a second entry that is long enough as well" };
+	}
+}
+
+TEST_P(TemporaryTable, "SelfTest.Params", temporary_table())
+{
+	UASSERT_EQ(temporary_table()[case_index()], param());
+}
+
+TEST(TemporaryTableIsEvaluatedOnce, "SelfTest.Params")
+{
+	UASSERT_EQ(size_t(2), TemporaryTable::case_count());
+	UASSERT_EQ(&TemporaryTable::param_table(), &TemporaryTable::param_table());
+}
+
+namespace
+{
+	// a pass, a failure whose message needs escaping and the fourth case of a TEST_P
+	template<class Reporter_Type>
+	std::string report_sample()
+	{
+		std::ostringstream os;
+		{
+			Reporter_Type reporter(os);
+			reporter(run_inner<Passer>(utest::Run_Options()));
+			reporter(run_inner<Multi_Line_Mismatch>(utest::Run_Options()));
+			utest::Result param;
+			param.case_index = 3;
+			utest::Runner::run(static_cast<const utest::Info*>(&FloatingPointRange::s_info), param);
+			reporter(param);
+		}
+		return os.str();
+	}
+}
+
+TEST(TapReportsEachResult, "SelfTest.Reporters")
+{
+	const std::string tap = report_sample<utest::Tap_Reporter>();
+	UASSERT_EQ(size_t(0), tap.find("TAP version 13\nok 1 - SelfTest.Inner.Inner\nnot ok 2 - SelfTest.Inner.Inner\n  ---\n  status: fail\n"));
+	UASSERT(contains(tap, "      message: \"Expected [first\\tline\\nsecond] saw [first\\tline\\r\\nsecond]\"\n  ...\n"));
+	UASSERT(contains(tap, "\nok 3 - SelfTest.Params.FloatingPointRange/3\n1..3\n"));
+}
+
+TEST(JsonLinesReportsEachResult, "SelfTest.Reporters")
+{
+	std::istringstream lines(report_sample<utest::Json_Lines_Reporter>());
+	std::string pass;
+	std::string fail;
+	std::string param;
+	std::string extra;
+	UASSERT(std::getline(lines, pass) && std::getline(lines, fail) && std::getline(lines, param));
+	UASSERT(!std::getline(lines, extra));
+
+	UASSERT_EQ(size_t(0), pass.find("{\"name\":\"Inner\",\"category\":\"SelfTest.Inner\",\"file\":"));
+	UASSERT(contains(pass, ",\"status\":\"pass\","));
+	UASSERT(contains(pass, ",\"failures\":[]}"));
+	UASSERT(!contains(pass, "\"case\""));
+
+	UASSERT(contains(fail, ",\"status\":\"fail\","));
+	UASSERT(contains(fail, ",\"message\":\"Expected [first\\tline\\nsecond] saw [first\\tline\\r\\nsecond]\"}]}"));
+
+	UASSERT_EQ(size_t(0), param.find("{\"name\":\"FloatingPointRange\",\"category\":\"SelfTest.Params\","));
+	UASSERT(contains(param, ",\"case\":3,\"status\":\"pass\","));
+}
+
+TEST(TraceRecorderWritesTraceEvents, "SelfTest.Trace")
+{
+	const auto origin = std::chrono::steady_clock::now();
+	utest::Result first = timed_result(named_info<Passer>("Traced"), 3500);
+	first.started = origin;
+	first.setup_duration = std::chrono::nanoseconds(1000);
+	first.test_duration = std::chrono::nanoseconds(2500);
+
+	utest::Result second;
+	second.info = &FloatingPointRange::s_info;
+	second.case_index = 2;
+	second.status = utest::Status::fail;
+	second.worker = 2;
+	second.started = origin + std::chrono::nanoseconds(5000);
+	second.test_duration = std::chrono::nanoseconds(1500);
+	second.teardown_duration = std::chrono::nanoseconds(500);
+
+	utest::Trace_Recorder trace;
+	utest::Result not_a_test;
+	trace.record(not_a_test);
+	trace.record(first);
+	// each thread records into a buffer of its own
+	std::thread worker([&trace, &second]() { trace.observer()(second); });
+	worker.join();
+	UASSERT_EQ(size_t(2), trace.size());
+
+	std::ostringstream os;
+	UASSERT(trace.write(os));
+	const std::string file = std::string("\"file\":\"") + __FILE__ + "\"";
+	const std::string expected = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+		"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"main\"}},\n"
+		"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"worker 2\"}},\n"
+		"{\"name\":\"SelfTest.Inner.Traced\",\"cat\":\"SelfTest.Inner\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":0.000,\"dur\":3.500,"
+			"\"args\":{\"status\":\"pass\"," + file + ",\"line\":" + std::to_string(first.info->line) + "}},\n"
+		"{\"name\":\"pre_test\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":0.000,\"dur\":1.000},\n"
+		"{\"name\":\"execute_test\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":1.000,\"dur\":2.500},\n"
+		"{\"name\":\"SelfTest.Params.FloatingPointRange/2\",\"cat\":\"SelfTest.Params\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":5.000,"
+			"\"dur\":2.000,\"args\":{\"status\":\"fail\"," + file + ",\"line\":" + std::to_string(second.info->line) + "}},\n"
+		"{\"name\":\"execute_test\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":5.000,\"dur\":1.500},\n"
+		"{\"name\":\"post_test\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":6.500,\"dur\":0.500}\n"
+		"]}\n";
+	UASSERT_EQ(expected, os.str());
+}
+
+namespace
+{
+	// writes one shard's results into a binary log
+	void write_log(const std::string& path, const std::vector<utest::Result>& results)
+	{
+		utest::Result_Log_Reporter log(path);
+		for (const auto& res : results)
+		{
+			log(res);
+		}
+	}
+
+	// one line per entry of the log, or nothing if the log can't be opened
+	std::vector<std::string> read_log(const std::string& path)
+	{
+		std::vector<std::string> lines;
+		utest::Result_Log log;
+		if (log.open(path))
+		{
+			log.for_each([&lines](const utest::Result_Log::Entry& e)
+			{
+				std::string line = std::string(e.category) + "." + e.name + "/" + std::to_string(e.case_index)
+					+ " " + utest::status_name(e.status) + " " + std::to_string(e.duration.count());
+				for (const auto& f : e.failures)
+				{
+					line += std::string(" [") + f.message + "]";
+				}
+				lines.push_back(line);
+			});
+			if (lines.size() != log.size())
+			{
+				lines.push_back("size() disagrees with for_each()");
+			}
+		}
+		return lines;
+	}
+
+	std::vector<char> read_bytes(const std::string& path)
+	{
+		std::ifstream in(path, std::ios::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+}
+
+TEST(ResultLogRoundTrips, "SelfTest.ResultLog")
+{
+	utest::Result failed = run_inner<Multi_Line_Mismatch>(utest::Run_Options());
+	failed.duration = std::chrono::nanoseconds(7000);
+	utest::Result param = timed_result(&FloatingPointRange::s_info, 3500);
+	param.case_index = 3;
+
+	const Temp_File first("first.ulog");
+	const Temp_File second("second.ulog");
+	const Temp_File merged("merged.ulog");
+	write_log(first.name, { timed_result(named_info<Passer>("Logged"), 1000), failed, param });
+	write_log(second.name, { timed_result(named_info<Passer>("Logged"), 2000), param });
+
+	const std::vector<std::string> expected_first = {
+		"SelfTest.Inner.Logged/0 pass 1000",
+		"SelfTest.Inner.Inner/0 fail 7000 [Expected [first\tline\nsecond] saw [first\tline\r\nsecond]]",
+		"SelfTest.Params.FloatingPointRange/3 pass 3500",
+	};
+	UASSERT(read_log(first.name) == expected_first);
+
+	// the merge keeps the order of its inputs, sharing the tests they have in common
+	UASSERT(utest::Result_Log::merge({ first.name, second.name }, merged.name));
+	std::vector<std::string> expected_merged = expected_first;
+	expected_merged.push_back("SelfTest.Inner.Logged/0 pass 2000");
+	expected_merged.push_back("SelfTest.Params.FloatingPointRange/3 pass 3500");
+	UASSERT(read_log(merged.name) == expected_merged);
+	UASSERT(read_bytes(merged.name).size() < read_bytes(first.name).size() + read_bytes(second.name).size());
+
+	// an input that can't be read fails the merge, but the rest is still written
+	const Temp_File missing("missing.ulog");
+	UASSERT(!utest::Result_Log::merge({ missing.name, second.name }, merged.name));
+	UASSERT_EQ(size_t(2), read_log(merged.name).size());
+}
+
+TEST(ResultLogIgnoresACutOffRecord, "SelfTest.ResultLog")
+{
+	const Temp_File whole("whole.ulog");
+	write_log(whole.name, { timed_result(named_info<Passer>("Kept"), 1000), timed_result(named_info<Passer>("Lost"), 2000) });
+	const std::vector<char> bytes = read_bytes(whole.name);
+	UASSERT_EQ(size_t(2), read_log(whole.name).size());
+
+	// a run that crashed mid-write leaves the records before the last one readable
+	const Temp_File cut("cut.ulog");
+	cut.write(bytes.data(), bytes.size() - 1);
+	const std::vector<std::string> expected = { "SelfTest.Inner.Kept/0 pass 1000" };
+	UASSERT(read_log(cut.name) == expected);
+
+	const Temp_File merged("cut_merged.ulog");
+	UASSERT(utest::Result_Log::merge({ cut.name }, merged.name));
+	UASSERT(read_log(merged.name) == expected);
+
+	// cut inside the header, or not a log at all
+	utest::Result_Log log;
+	cut.write(bytes.data(), 3);
+	UASSERT(!log.open(cut.name));
+	const std::string text(bytes.size(), 'x');
+	cut.write(text.data(), text.size());
+	UASSERT(!log.open(cut.name));
+	UASSERT(!log.open(whole.name + ".none"));
+}
+
+int main()
+{
+	const utest::Status status = utest::Runner::run_registered([](const utest::Result& res)
+	{
+		if (res.status != utest::Status::pass)
+		{
+			std::printf("%s %s\n", utest::status_name(res.status), res.info->name);
+			for (const auto& failure : res.failures)
+			{
+				std::printf("  %s(%d): %s\n", failure.file(), failure.line(), failure.str().c_str());
+			}
+		}
+	});
+	std::printf("%zu tests, %s\n", utest::Registry::get().tests().size(), utest::status_name(status));
+	return status == utest::Status::pass ? 0 : 1;
+}
@@ -1,6 +1,6 @@
 #pragma once
 /*
-utest - The micro unit test framework for C++11
+utest - The micro unit test framework for C++14
 
 Author - Oli Wilkinson (https://github.com/evolutional/upptest)
 
@@ -12,6 +12,9 @@ UTEST_CPP_IMPLEMENTATION in exactly on source file.
 	#define UTEST_CPP_IMPLEMENTATION
 	#include "upptest.h"
 
+Source files that only declare tests can include the lighter upptest_lite.h instead, which this
+file includes. Both files must be kept together.
+
 USAGE
 -----
 
@@ -47,383 +50,6849 @@ OTHER DEALINGS IN THE SOFTWARE.
 For more information, please refer to <http://unlicense.org>
 */
 
-#include <chrono>
-#include <exception>
+#include "upptest_lite.h"
+
 #include <functional>
-#include <memory>
+#include <mutex>
 #include <sstream>
-#include <string>
 #include <vector>
 
+#if !defined(__GNUC__) && !defined(__clang__)
+#include <atomic>
+#endif
+
+#ifndef UTEST_CPP_PROCESS_ISOLATION
+#if defined(__unix__) || defined(__APPLE__)
+#define UTEST_CPP_PROCESS_ISOLATION 1
+#else
+#define UTEST_CPP_PROCESS_ISOLATION 0
+#endif
+#endif
+
+// Counting the allocations of each test replaces the global operator new and delete, so it is opt-in
+// and must be set the same way in every source file that includes this one.
+#ifndef UTEST_CPP_TRACK_ALLOCATIONS
+#define UTEST_CPP_TRACK_ALLOCATIONS 0
+#endif
+
+// Hardware counters per test through perf_event_open; Linux only, and like allocation tracking it
+// must be set the same way in every source file.
+#ifndef UTEST_CPP_PERF_COUNTERS
+#define UTEST_CPP_PERF_COUNTERS 0
+#endif
+#if UTEST_CPP_PERF_COUNTERS && !defined(__linux__)
+#undef UTEST_CPP_PERF_COUNTERS
+#define UTEST_CPP_PERF_COUNTERS 0
+#endif
+
+// Coroutine tests (TEST_ASYNC) need C++20 coroutines, and exceptions to carry failed asserts out of
+// them. The standard chosen must be the same for every source file.
+#ifndef UTEST_CPP_COROUTINES
+#if defined(__cpp_impl_coroutine) && !UTEST_CPP_NO_EXCEPTIONS
+#define UTEST_CPP_COROUTINES 1
+#else
+#define UTEST_CPP_COROUTINES 0
+#endif
+#endif
+#if UTEST_CPP_COROUTINES
+#include <condition_variable>
+#include <coroutine>
+#endif
+
+#ifdef UTEST_CPP_IMPLEMENTATION
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#if UTEST_CPP_PROCESS_ISOLATION
+#include <cerrno>
+#include <cstdint>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#if UTEST_CPP_PERF_COUNTERS
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif	// UTEST_CPP_IMPLEMENTATION
+
 namespace utest
 {
-#define TEST_FIXTURE(name)		class name : public utest::Test	
-#define SETUP()			virtual void pre_test() override
-#define TEARDOWN()		virtual void post_test() override
-#define TEST_AUTO_NAME(name)	g_utestautoreg_test_##name
-#define TEST_F(name, fixture, category)	\
+#define TEST_SUITE_FIXTURE(name, context)	class name : public utest::Suite_Test< context >
+
+#if UTEST_CPP_COROUTINES
+#define TEST_ASYNC_FIXTURE(name)	class name : public utest::Async_Test
+#define TEST_ASYNC_F_OPT(name, fixture, category, options)	\
+	class name : public fixture	\
+	{	\
+		public:	\
+			name() : fixture() {}	\
+			utest::Async execute_async_test() override;	\
+			static std::unique_ptr<utest::Test> create() { return std::make_unique< name >(); }	\
+			static utest::Test* emplace(void* storage) { return ::new (storage) name(); }	\
+			static utest::Info s_info;	\
+	};	\
+	utest::Info name::s_info(&name::create, &name::emplace, sizeof(name), alignof(name),	\
+		#name, category, __FILE__, __LINE__, options, nullptr, ::utest::detail::suite_of< name >(0), true);	\
+	namespace { utest::Auto_Registered_Test TEST_AUTO_NAME(name)(&name::s_info); } \
+	utest::Async name::execute_async_test()
+
+#define TEST_ASYNC_F(name, fixture, category)	TEST_ASYNC_F_OPT(name, fixture, category, utest::Test_Options())
+#define TEST_ASYNC(name, category)	TEST_ASYNC_F(name, utest::Async_Test, category)
+#define TEST_ASYNC_OPT(name, category, options)	TEST_ASYNC_F_OPT(name, utest::Async_Test, category, options)
+#endif
+
+#define BENCHMARK_FIXTURE(name)	class name : public utest::Benchmark
+#define BENCHMARK_F_OPT(name, fixture, category, options)	\
 	class name : public fixture	\
 	{	\
 		public:	\
 			name() : fixture() {}	\
-			void execute_test() override;	\
-			static utest::info s_info;	\
+			static std::unique_ptr<utest::Test> create() { return std::make_unique< name >(); }	\
+			static utest::Test* emplace(void* storage) { return ::new (storage) name(); }	\
+			static utest::Info s_info;	\
+		private:	\
+			void execute_batch(const unsigned long long iterations) override	\
+			{	\
+				for (unsigned long long i = 0; i < iterations; ++i)	\
+				{	\
+					execute_iteration();	\
+				}	\
+			}	\
+			void execute_iteration();	\
 	};	\
-	utest::info name::s_info([]() {return std::make_unique< name >();}, #name, category, __FILE__, __LINE__);	\
-	namespace { utest::auto_registered_test TEST_AUTO_NAME(name)(&name::s_info); } \
-	void name::execute_test()
+	utest::Info name::s_info(&name::create, &name::emplace, sizeof(name), alignof(name),	\
+		#name, category, __FILE__, __LINE__, options);	\
+	namespace { utest::Auto_Registered_Test TEST_AUTO_NAME(name)(&name::s_info); } \
+	void name::execute_iteration()
 
-#define TEST(name, category)	TEST_F(name, utest::test, category)
+#define BENCHMARK_F(name, fixture, category)	BENCHMARK_F_OPT(name, fixture, category, utest::Test_Options())
+#define BENCHMARK(name, category)	BENCHMARK_F(name, utest::Benchmark, category)
 
-#define UASSERT(e)	::utest::assert::expr(e, __FILE__ ,__LINE__)
-#define UASSERT_EQ(expected, actual)	::utest::assert::eq(expected, actual, __FILE__ ,__LINE__)
-#define UASSERT_NEQ(not_expected, actual)	::utest::assert::neq(not_expected, actual, __FILE__ ,__LINE__)
-#define UASSERT_TRUE(v)	::utest::assert::is_true(v, __FILE__ ,__LINE__)
-#define UASSERT_FALSE(v)	::utest::assert::is_false(v, __FILE__ ,__LINE__)
-#define UASSERT_NULL(ptr)	::utest::assert::is_null(ptr, __FILE__ ,__LINE__)
-#define UASSERT_NOT_NULL(ptr)	::utest::assert::is_not_null(ptr, __FILE__ ,__LINE__)
-#define UASSERT_FAIL(msg)	::utest::assert::fail(msg, __FILE__ ,__LINE__)
+	class Info;
 
-	class assert_fail_exception
-		: public std::exception
+	// Per-iteration timings of a benchmark, in nanoseconds.
+	struct Benchmark_Stats final
 	{
-	public:
-		explicit assert_fail_exception(const std::string& msg, const char* file_name, const int line_num)
-			: _msg(msg)
-			, _file_name(file_name)
-			, _line_num(line_num)
-		{
-		}
-		const char* what() const throw() override { return _msg.c_str(); }
-		std::string what_str() const { return _msg; }
-		const char* file_name() const { return _file_name; }
-		int line_num() const { return _line_num; }
-	private:
-		std::string _msg;
-		const char* _file_name;
-		const int _line_num;
+		Benchmark_Stats()
+			: iterations(0)
+			, samples(0)
+			, min(0)
+			, median(0)
+			, mean(0)
+			, p99(0)
+			, stddev(0)
+		{}
+
+		unsigned long long iterations;	// iterations timed in each sample
+		unsigned samples;				// zero when the test is not a benchmark
+		double min;
+		double median;
+		double mean;
+		double p99;
+		double stddev;
 	};
 
-	enum class Status
+	// What a test allocated through operator new on its own thread while it executed
+	struct Allocation_Stats final
 	{
-		not_run,
-		pass,
-		fail
+		Allocation_Stats()
+			: tracked(false)
+			, count(0)
+			, bytes(0)
+			, peak_bytes(0)
+			, leaked_count(0)
+			, leaked_bytes(0)
+		{}
+
+		bool tracked;					// false unless built with UTEST_CPP_TRACK_ALLOCATIONS
+		unsigned long long count;
+		unsigned long long bytes;
+		unsigned long long peak_bytes;	// the most that was live at once
+		unsigned long long leaked_count;	// allocations still live when the test finished
+		unsigned long long leaked_bytes;
 	};
-	
-	class Info;
+
+	// Hardware counters over execute_test(), counting user space only. For a benchmark they are per
+	// iteration of the measured samples. An event the CPU doesn't offer stays zero.
+	struct Counter_Stats final
+	{
+		Counter_Stats()
+			: tracked(false)
+			, cycles(0)
+			, instructions(0)
+			, branch_misses(0)
+			, cache_misses(0)
+		{}
+
+		bool tracked;		// false unless built with UTEST_CPP_PERF_COUNTERS and the kernel allowed it
+		double cycles;
+		double instructions;
+		double branch_misses;
+		double cache_misses;	// last level cache
+	};
+
+	namespace detail
+	{
+		class Allocation_Scope;
+
+		// Keeps what the framework allocates for its own bookkeeping, such as the failure list and
+		// suite contexts, out of the running test's Allocation_Stats. Does nothing unless built with
+		// UTEST_CPP_TRACK_ALLOCATIONS.
+		class Allocation_Pause final
+		{
+		public:
+			Allocation_Pause();
+			~Allocation_Pause();
+
+			Allocation_Pause(const Allocation_Pause&) = delete;
+			Allocation_Pause& operator=(const Allocation_Pause&) = delete;
+
+		private:
+			Allocation_Scope* _paused;
+		};
+	}
 
 	struct Result final
 	{
 		Result()
 			: info(nullptr)
 			, status(Status::not_run)
-			, duration()
-			, err_message()
-			, err_file()
-			, err_line(0)
+			, duration(0)
+			, setup_duration(0)
+			, test_duration(0)
+			, teardown_duration(0)
+			, benchmark()
+			, allocations()
+			, counters()
+			, failure()
+			, failures()
+			, case_index(0)
+			, started()
+			, worker(0)
 		{}
 
 		void exception(const std::exception& ex)
 		{
-			status = Status::fail;
-			err_message = "unhandled exception";
+			std::string msg("unhandled exception");
 			if (ex.what())
 			{
-				err_message.append(": ");
-				err_message.append(ex.what());
+				msg.append(": ");
+				msg.append(ex.what());
 			}
+			fail(Failure::message(std::move(msg), "", 0));
 		}
 
-		void fail(const std::string& msg, const std::string& file_name, const int line_num)
+		void fail(const Failure& failure_)
 		{
+			detail::Allocation_Pause untracked;
 			status = Status::fail;
-			err_message = msg;
-			err_file = file_name;
-			err_line = line_num;
+			if (failures.empty())
+			{
+				failure = failure_;
+			}
+			failures.push_back(failure_);
+		}
+
+		void fail(const std::string& msg, const char* file_name, const int line_num)
+		{
+			fail(Failure::message(msg, file_name, line_num));
 		}
 
 		const Info* info;
 		Status status;
-		std::chrono::milliseconds duration;
-		std::string err_message;
-		std::string err_file;
-		int err_line;
+		std::chrono::nanoseconds duration;			// pre_test, execute_test and post_test combined
+		std::chrono::nanoseconds setup_duration;	// pre_test()
+		std::chrono::nanoseconds test_duration;		// execute_test()
+		std::chrono::nanoseconds teardown_duration;	// post_test()
+		Benchmark_Stats benchmark;
+		Allocation_Stats allocations;
+		Counter_Stats counters;
+		Failure failure;		// the first reason the test did not pass; the message is formatted on demand
+		std::vector<Failure> failures;	// every failure in the order it happened, `failure` included; allocates
+		size_t case_index;		// which case of a TEST_P this result is for; zero for other tests
+		std::chrono::steady_clock::time_point started;	// when pre_test began; the phases follow on from it
+		unsigned worker;		// the pool worker that ran it, from 1; 0 is the thread that started the run
 	};
 
-	class Test;
-	
-	class Info
+	namespace detail
 	{
-	public:
-		typedef std::function<std::unique_ptr<Test>()> Factory_Func;
-		Info(const Factory_Func& f_, const char* name_, const char* category_, const char* file_, const int line_)
-			: f(f_)
-			, name(name_)
-			, category(category_)
-			, file(file_)
-			, line(line_)
-		{}
+#if UTEST_CPP_TRACK_ALLOCATIONS
+		// Counts the allocations made on this thread while it is the innermost scope. Each block
+		// remembers the scope it was counted by, so memory that was allocated before the scope
+		// started doesn't count against it when freed. A scope opened on the stats the innermost
+		// one is already filling in does nothing, and leaves the counting to that one.
+		//
+		// An instance scope is opened around a test instance that several results share. What the
+		// scopes of those results leave live is handed to it, and only counts as leaked if it is still
+		// live when the instance scope stops, after the fixture has been destroyed.
+		class Allocation_Scope final
+		{
+		public:
+			explicit Allocation_Scope(Allocation_Stats& stats, const bool instance = false);
+			~Allocation_Scope();
 
-		Factory_Func f;
-		const char* name;
-		const char* category;
-		const char* file;
-		const int line;
-	};
+			// fills in the stats; what is still live now is counted as leaked
+			void stop();
 
-	class Default_Fail_Handler
-	{
-	public:
-		static void handle(const std::string& message, const char* file_name = "", const int line_num = 0)
+			static Allocation_Scope*& current()
+			{
+				static thread_local Allocation_Scope* scope = nullptr;
+				return scope;
+			}
+
+			unsigned long long id() const { return _id; }
+			Allocation_Scope* previous() const { return _previous; }
+			void allocated(const size_t size);
+
+			// false if the block was counted by neither this scope nor one it was handed by
+			bool freed(const unsigned long long scope, const size_t size);
+
+			Allocation_Scope(const Allocation_Scope&) = delete;
+			Allocation_Scope& operator=(const Allocation_Scope&) = delete;
+
+		private:
+			// what a scope that stopped inside an instance scope left live
+			struct Handed_Over
+			{
+				unsigned long long id;
+				Allocation_Stats* stats;
+				unsigned long long live_count;
+				unsigned long long live_bytes;
+			};
+
+			Allocation_Stats& _stats;
+			Allocation_Scope* _previous;
+			unsigned long long _id;
+			unsigned long long _live_count;
+			unsigned long long _live_bytes;
+			bool _stopped;
+			bool _instance;
+			std::vector<Handed_Over> _handed_over;
+		};
+#endif
+
+#if UTEST_CPP_PERF_COUNTERS
+		// running totals of this thread's counters, scaled for the time the kernel had them scheduled
+		struct Counter_Sample
 		{
-			throw assert_fail_exception(message, file_name, line_num);
-		}
-	};
+			unsigned long long time_enabled;
+			unsigned long long time_running;
+			unsigned long long values[4];	// cycles, instructions, branch misses, cache misses
+		};
 
-	template<class Fail_Handler>
-	class Basic_Assert
-	{
-	public:
-		template<typename T1, typename T2>
-		static void eq(const T1& expected, const T2& actual, const char* file_name = "", const int line_num = 0)
+		// false when the counters can't be opened on this thread, for instance in a container
+		bool sample_counters(Counter_Sample& out_sample);
+		Counter_Stats counter_delta(const Counter_Sample& from, const Counter_Sample& to, const double divisor);
+
+		class Counter_Scope final
 		{
-			if (expected == actual)
+		public:
+			explicit Counter_Scope(Counter_Stats& stats)
+				: _stats(stats)
+				, _before()
+				, _counting(sample_counters(_before))
+			{}
+
+			// a body left by a failed assert is still sampled, on the way out
+			~Counter_Scope() { stop(); }
+
+			Counter_Scope(const Counter_Scope&) = delete;
+			Counter_Scope& operator=(const Counter_Scope&) = delete;
+
+			// samples the counters the first time it is called
+			void stop()
 			{
-				return;
+				Counter_Sample after;
+				if (_counting && sample_counters(after))
+				{
+					_stats = counter_delta(_before, after, 1.0);
+				}
+				_counting = false;
 			}
-			std::ostringstream err;
-			err << "Expected [" << expected << "] saw [" << actual << "]";
-			fail(err.str(), file_name, line_num);
-		}
 
-		template<typename T1, typename T2>
-		static void neq(const T1& expected, const T2& actual, const char* file_name = "", const int line_num = 0)
+		private:
+			Counter_Stats& _stats;
+			Counter_Sample _before;
+			bool _counting;
+		};
+#endif
+	}
+
+	namespace detail
+	{
+		// The suite contexts built on this thread. One is built the first time a test asks for it and
+		// stays until the runner knows no more tests of that suite will run here.
+		class Suite_Cache final
 		{
-			if (expected != actual)
+		public:
+			static Suite_Cache& get()
 			{
-				return;
+				static thread_local Suite_Cache cache;
+				return cache;
 			}
-			std::ostringstream err;
-			err << "Expected not [" << expected << "] saw [" << actual << "]";
-			fail(err.str(), file_name, line_num);
-		}
 
-		static void expr(const bool ex, const char* file_name = "", const int line_num = 0)
-		{
-			if (ex)
+			~Suite_Cache()
 			{
-				return;
+				release_all();
 			}
-			fail("Assert expression failed", file_name, line_num);
-		}
 
-		static void is_true(const bool condition, const char* file_name = "", const int line_num = 0)
-		{
-			if (condition)
+			void* acquire(const Suite_Info* suite)
 			{
-				return;
+				for (const auto& live : _live)
+				{
+					if (live.first == suite)
+					{
+						return live.second;
+					}
+				}
+				// the context outlives the test that happens to build it
+				Allocation_Pause untracked;
+				_live.reserve(_live.size() + 1);
+				void* context = suite->create();
+				_live.emplace_back(suite, context);
+				return context;
 			}
-			fail("Expected [true] saw [false]", file_name, line_num);
-		}
 
-		static void is_false(const bool condition, const char* file_name = "", const int line_num = 0)
-		{
-			if (!condition)
+			void release(const Suite_Info* suite)
 			{
-				return;
+				release_if([suite](const Suite_Info* live) { return live == suite; });
 			}
-			fail("Expected [false] saw [true]", file_name, line_num);
-		}
 
-		template<typename T>
-		static void is_null(const T* ptr, const char* file_name = "", const int line_num = 0)
-		{
-			if (ptr == nullptr)
+			template<class Predicate>
+			void release_if(const Predicate& done)
 			{
-				return;
+				for (size_t i = _live.size(); i-- > 0;)
+				{
+					if (done(_live[i].first))
+					{
+						const auto live = _live[i];
+						_live.erase(_live.begin() + static_cast<std::ptrdiff_t>(i));
+						live.first->destroy(live.second);
+					}
+				}
 			}
-			fail("Expected [nullptr]", file_name, line_num);
-		}
 
-		template<typename T>
-		static void is_not_null(const T* ptr, const char* file_name = "", const int line_num = 0)
-		{
-			if (ptr != nullptr)
+			void release_all()
 			{
-				return;
+				release_if([](const Suite_Info*) { return true; });
 			}
-			fail("Expected not [nullptr]", file_name, line_num);
-		}
 
-		static void fail(const std::string& message, const char* file_name = "", const int line_num = 0)
-		{
-			Fail_Handler::handle(message, file_name, line_num);
-		}
-	};
+			// a forked worker drops what it inherited without destroying it; the parent still owns it
+			void forget()
+			{
+				_live.clear();
+			}
 
-	typedef Basic_Assert<Default_Fail_Handler> assert;
+		private:
+			Suite_Cache()
+				: _live()
+			{}
 
-	class Test
-	{
-	public:
-		virtual ~Test() {}
+			std::vector<std::pair<const Suite_Info*, void*>> _live;
+		};
 
-		Status execute(Result& res)
+		// moves the tests of each suite up to where the first of them is, so a context is built once
+		// for the whole group; other tests keep their order
+		inline void group_by_suite(std::vector<const Info*>& tests)
 		{
-			auto test_start_time = std::chrono::steady_clock::now();
-			try
+			std::vector<std::pair<const Suite_Info*, std::vector<const Info*>>> groups;
+			for (const auto* ti : tests)
 			{
-				pre_test();
-				execute_test();
-				res.status = Status::pass;
+				if (!ti->suite)
+				{
+					continue;
+				}
+				auto itr = groups.begin();
+				while (itr != groups.end() && itr->first != ti->suite)
+				{
+					++itr;
+				}
+				if (itr == groups.end())
+				{
+					groups.emplace_back(ti->suite, std::vector<const Info*>());
+					itr = groups.end() - 1;
+				}
+				itr->second.push_back(ti);
 			}
-			catch (const assert_fail_exception& ex)
+			if (groups.empty())
 			{
-				res.fail(ex.what_str(), ex.file_name(), ex.line_num());
+				return;
 			}
-			catch (const std::exception& ex)
+
+			std::vector<const Info*> grouped;
+			grouped.reserve(tests.size());
+			for (const auto* ti : tests)
 			{
-				res.exception(ex);
+				if (!ti->suite)
+				{
+					grouped.push_back(ti);
+					continue;
+				}
+				for (auto& group : groups)
+				{
+					if (group.first == ti->suite)
+					{
+						grouped.insert(grouped.end(), group.second.begin(), group.second.end());
+						group.second.clear();
+						break;
+					}
+				}
 			}
-			post_test();			
-			auto test_end_time = std::chrono::steady_clock::now();
-			auto test_duration = std::chrono::duration_cast<std::chrono::milliseconds>(test_end_time - test_start_time);
-			res.duration = test_duration;
-			return res.status;
+			tests.swap(grouped);
 		}
+	}
+
+	// Base of fixtures sharing a Context that is expensive to build. The first test of the fixture
+	// to call suite() on a worker builds it, and the rest of that worker's tests of the fixture reuse
+	// it. It is destroyed once the worker has run the last of them.
+	template<class Context>
+	class Suite_Test : public Test
+	{
+	public:
+		typedef Context Suite_Context;
 
 	protected:
-		Test(){}
-		virtual void pre_test() {}
-		virtual void post_test() {}
-	private:
-		virtual void execute_test() = 0;
-	};	
+		static Context& suite()
+		{
+			return *static_cast<Context*>(detail::Suite_Cache::get().acquire(&detail::Suite_Type<Context>::info));
+		}
+	};
 
-	class Registry
+#if UTEST_CPP_COROUTINES
+	// The coroutine type of TEST_ASYNC bodies and of the coroutines they co_await. It starts once it
+	// is awaited, and an exception thrown inside it (a failed assert included) comes out of co_await.
+	class [[nodiscard]] Async final
 	{
 	public:
-		typedef std::vector<const Info*> Container_Type;
+		struct promise_type
+		{
+			promise_type()
+				: continuation()
+				, error()
+			{}
 
-		virtual ~Registry();
+			struct Final_Awaiter
+			{
+				bool await_ready() noexcept { return false; }
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+				{
+					const auto next = handle.promise().continuation;
+					return next ? next : std::noop_coroutine();
+				}
+				void await_resume() noexcept {}
+			};
 
-		static Registry& get();
-		void add(const Info* test)
+			Async get_return_object() { return Async(std::coroutine_handle<promise_type>::from_promise(*this)); }
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			Final_Awaiter final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { error = std::current_exception(); }
+
+			std::coroutine_handle<> continuation;	// resumed once this one finishes
+			std::exception_ptr error;
+		};
+
+		Async(Async&& other) noexcept
+			: _handle(other._handle)
 		{
-			_tests.push_back(test);
+			other._handle = nullptr;
+		}
+
+		~Async()
+		{
+			if (_handle)
+			{
+				_handle.destroy();
+			}
+		}
+
+		Async(const Async&) = delete;
+		Async& operator=(const Async&) = delete;
+		Async& operator=(Async&&) = delete;
+
+		bool await_ready() const noexcept { return !_handle || _handle.done(); }
+
+		std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting) noexcept
+		{
+			_handle.promise().continuation = awaiting;
+			return _handle;
+		}
+
+		void await_resume()
+		{
+			if (_handle && _handle.promise().error)
+			{
+				std::rethrow_exception(_handle.promise().error);
+			}
 		}
-		Container_Type& tests() { return _tests; }
 
-	protected:
-		Registry();		
 	private:
-		Container_Type _tests;
-		static std::unique_ptr<Registry> _instance;
+		explicit Async(const std::coroutine_handle<promise_type> handle)
+			: _handle(handle)
+		{}
+
+		std::coroutine_handle<promise_type> _handle;
 	};
 
-	class Auto_Registered_Test
+	namespace detail
 	{
-	public:
-		explicit Auto_Registered_Test(const Info* info) : _info(info)
+		// Resumes the suspended coroutines of one thread. Anything may post to it from any thread; each
+		// coroutine is resumed with the Result it was suspended under made current again.
+		class Event_Loop final
+		{
+		public:
+			Event_Loop();
+
+			Event_Loop(const Event_Loop&) = delete;
+			Event_Loop& operator=(const Event_Loop&) = delete;
+
+			void post(const std::coroutine_handle<> handle, Result* const context);
+			void post_at(const std::chrono::steady_clock::time_point when, const std::coroutine_handle<> handle,
+				Result* const context);
+
+			// resumes everything that is due, first waiting for something to become due if nothing is
+			void run_once();
+
+		private:
+			struct Item
+			{
+				std::coroutine_handle<> handle;
+				Result* context;
+			};
+
+			struct Timer
+			{
+				std::chrono::steady_clock::time_point when;
+				unsigned long long order;
+				Item item;
+			};
+
+			static bool later(const Timer& a, const Timer& b);
+
+			std::mutex _mutex;
+			std::condition_variable _cv;
+			std::vector<Item> _ready;
+			std::vector<Item> _running;
+			std::vector<Timer> _timers;		// a min-heap on (when, order)
+			unsigned long long _order;
+		};
+
+		// the loop that the coroutines running on this thread were started on
+		inline Event_Loop*& current_event_loop()
 		{
-			Registry::get().add(info);
+			static thread_local Event_Loop* loop = nullptr;
+			return loop;
 		}
-		const Info* _info;
-	};
 
-	class Runner
+		struct Sleep_Awaiter
+		{
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(const std::coroutine_handle<> handle) const
+			{
+				current_event_loop()->post_at(when, handle, current_result());
+			}
+			void await_resume() const noexcept {}
+
+			std::chrono::steady_clock::time_point when;
+		};
+	}
+
+	// Suspends the calling coroutine for at least `duration`; the thread runs other tests meanwhile.
+	template<class Rep, class Period>
+	detail::Sleep_Awaiter sleep_for(const std::chrono::duration<Rep, Period>& duration)
+	{
+		return detail::Sleep_Awaiter{ std::chrono::steady_clock::now()
+			+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration) };
+	}
+
+	// Lets the other coroutines on this thread run before carrying on.
+	inline detail::Sleep_Awaiter yield()
+	{
+		return detail::Sleep_Awaiter{ std::chrono::steady_clock::time_point() };
+	}
+
+	// A one-shot signal that coroutine tests co_await, and the way to hand them the completion of
+	// callback-driven I/O: set() may be called from any thread, and every waiter is resumed on the
+	// thread it was suspended on.
+	class Async_Event final
 	{
 	public:
-		typedef const Info* const Info_Type;
+		Async_Event()
+			: _mutex()
+			, _set(false)
+			, _waiters()
+		{}
 
-		static Status run(const Info* const ti, Result& out_res)
+		Async_Event(const Async_Event&) = delete;
+		Async_Event& operator=(const Async_Event&) = delete;
+
+		void set()
 		{
-			auto tst = ti->f();
-			out_res.info = ti;
-			return tst->execute(out_res);
+			std::vector<Waiter> waiters;
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_set = true;
+				waiters.swap(_waiters);
+			}
+			// the event is not touched again, so a waiter is free to destroy it as soon as it resumes
+			for (const auto& w : waiters)
+			{
+				w.loop->post(w.handle, w.context);
+			}
 		}
 
-		template<typename Iterator_Type, class Execution_Observer>
-		static Status run(Iterator_Type itr_begin, Iterator_Type itr_end,
-			const Execution_Observer& observer)
+		bool is_set() const
 		{
-			return run(itr_begin, itr_end, [](Info_Type) { return true; }, observer);
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _set;
 		}
 
-		template<typename Iterator_Type, class Binary_Predicate, class Execution_Observer>
-		static Status run(Iterator_Type itr_begin, Iterator_Type itr_end, const Binary_Predicate& filter,
-			const Execution_Observer& observer)
+		struct Awaiter
 		{
-			size_t pass(0), test_count(0);
-			for (auto itr = itr_begin; itr != itr_end; ++itr)
+			bool await_ready() const { return event.is_set(); }
+			bool await_suspend(const std::coroutine_handle<> handle)
 			{
-				const auto* const ti = *itr;
-				if (filter(ti))
+				std::lock_guard<std::mutex> lock(event._mutex);
+				if (event._set)
 				{
-					Result res;
-					auto r = run(ti, res);
-					if (r == Status::pass)
-					{
-						++pass;
-					}
-					++test_count;
-					observer(res);
+					return false;
 				}
+				event._waiters.push_back(Waiter{ detail::current_event_loop(), handle, detail::current_result() });
+				return true;
 			}
-			return pass == test_count ? Status::pass : Status::fail;
-		}
+			void await_resume() const noexcept {}
 
-		template<typename Container_Type, class Execution_Observer>
-		static Status run(const Container_Type& tests, const Execution_Observer& observer)
-		{
-			return run(tests.begin(), tests.end(), observer);
-		}
+			Async_Event& event;
+		};
 
-		template<typename Container_Type, class Binary_Predicate, class Execution_Observer>
-		static Status run(const Container_Type& tests, const Binary_Predicate& filter, const Execution_Observer& observer)
-		{
-			return run(tests.begin(), tests.end(), filter, observer);
-		}
+		Awaiter operator co_await() { return Awaiter{ *this }; }
 
-		template<class Execution_Observer>
-		static Status run_registered(const Execution_Observer& observer)
+	private:
+		struct Waiter
 		{
-			return run(Registry::get().tests(), [](Info_Type) { return true; }, observer);
-		}
+			detail::Event_Loop* loop;
+			std::coroutine_handle<> handle;
+			Result* context;
+		};
 
-		template<class Binary_Predicate, class Execution_Observer>
-		static Status run_registered(const Binary_Predicate& filter, const Execution_Observer& observer)
-		{
-			return run(Registry::get().tests(), filter, observer);
-		}
+		mutable std::mutex _mutex;
+		bool _set;
+		std::vector<Waiter> _waiters;
 	};
 
-#ifdef UTEST_CPP_IMPLEMENTATION
+	// Base of TEST_ASYNC tests, whose body is a coroutine. Runner::run_async() keeps many of them
+	// suspended on a few threads; every other runner runs the body to completion on the test's thread.
+	class Async_Test : public Test
+	{
+	public:
+		// execute() as a coroutine: pre_test(), the body and post_test(), timed and reported into res
+		Async execute_async(Result& res);
 
-	namespace detail
+	protected:
+		Async_Test() {}
+
+	private:
+		virtual Async execute_async_test() = 0;
+		void execute_test() override;
+	};
+#endif
+
+	struct Benchmark_Options final
 	{
-		class Concrete_Registry : public Registry {};
-	}
+		Benchmark_Options()
+			: warmup_time(std::chrono::milliseconds(20))
+			, measure_time(std::chrono::milliseconds(200))
+			, sample_count(30)
+			, max_iterations(1000000000ull)
+		{}
 
-	Registry& Registry::get()
+		std::chrono::nanoseconds warmup_time;	// untimed runs before measuring, also used to estimate the iteration cost
+		std::chrono::nanoseconds measure_time;	// target time spread across all the samples
+		unsigned sample_count;
+		unsigned long long max_iterations;		// upper bound on the iterations in a single sample
+	};
+
+	// Base of BENCHMARK tests. The body is one iteration; the batch size is calibrated so each
+	// sample is long enough to time reliably, and the statistics end up in Result::benchmark.
+	class Benchmark : public Test
 	{
-		static std::unique_ptr<Registry> instance;
-		if (!instance)
+	public:
+		// applies to every benchmark; change it before starting a run
+		static Benchmark_Options& options()
 		{
-			instance = std::make_unique<detail::Concrete_Registry>();
+			static Benchmark_Options opts;
+			return opts;
 		}
-		return *instance;
-	}
+
+	protected:
+		Benchmark(){}
+		void report(Result& res) override
+		{
+			res.benchmark = _stats;
+			if (_counters.tracked)
+			{
+				res.counters = _counters;
+			}
+		}
+	private:
+		void execute_test() override;
+		virtual void execute_batch(unsigned long long iterations) = 0;
+
+		Benchmark_Stats _stats;
+		Counter_Stats _counters;	// per iteration of the measured samples
+	};
+
+	// Keeps the compiler from discarding a value computed by a benchmark.
+	template<typename T>
+	inline void do_not_optimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static thread_local const volatile void* volatile sink;
+		sink = &value;
+#endif
+	}
+
+	template<typename T>
+	inline void do_not_optimize(T& value)
+	{
+#if defined(__clang__)
+		asm volatile("" : "+r,m"(value) : : "memory");
+#elif defined(__GNUC__)
+		// a single alternative: GCC 12 can pick the memory one of "+m,r" without storing the value first
+		asm volatile("" : "+m"(value) : : "memory");
+#else
+		static thread_local volatile void* volatile sink;
+		sink = &value;
+#endif
+	}
+
+	// Forces pending writes to memory, so stores a benchmark makes aren't optimized away.
+	inline void clobber_memory()
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : : "memory");
+#else
+		std::atomic_signal_fence(std::memory_order_acq_rel);
+#endif
+	}
+
+	// Selects a stable 1/count slice of the tests by hashing their name and category, so every
+	// machine running the same binary agrees on the split without any coordination.
+	struct Shard final
+	{
+		Shard(const unsigned index_, const unsigned count_)
+			: index(index_)
+			, count(count_)
+		{}
+
+		// reads UTEST_SHARD_INDEX and UTEST_SHARD_COUNT, defaulting to a single shard
+		static Shard from_environment();
+
+		static unsigned long long hash(const Info* const ti)
+		{
+			return hash(ti->name, ti->category);
+		}
+
+		static unsigned long long hash(const char* name, const char* category)
+		{
+			unsigned long long h = 14695981039346656037ull;
+			auto mix = [&h](const char* str)
+			{
+				for (; str && *str; ++str)
+				{
+					h = (h ^ static_cast<unsigned char>(*str)) * 1099511628211ull;
+				}
+				h = (h ^ 0xFFu) * 1099511628211ull;
+			};
+			mix(name);
+			mix(category);
+			return h;
+		}
+
+		bool operator()(const Info* const ti) const
+		{
+			return count <= 1 || hash(ti) % count == index;
+		}
+
+		unsigned index;
+		unsigned count;
+	};
+
+	// A query over the registered tests. Like Shard, a Selector is a filter predicate and works with
+	// every run overload, but Registry::select() answers it from the index instead of testing each
+	// registered test in turn.
+	class Selector final
+	{
+	public:
+		enum class Kind
+		{
+			all,
+			name,				// the test with exactly this name
+			category,			// every test in exactly this category
+			category_prefix,	// "Example" matches "Example" and "Example.Tests" but not "Examples"
+			glob				// '*' and '?' wildcards over the category, e.g. "Example.*"
+		};
+
+		static Selector all() { return Selector(Kind::all, std::string()); }
+		static Selector name(const std::string& name_) { return Selector(Kind::name, name_); }
+		static Selector category(const std::string& category_) { return Selector(Kind::category, category_); }
+		static Selector category_prefix(const std::string& prefix) { return Selector(Kind::category_prefix, prefix); }
+		static Selector glob(const std::string& pattern) { return Selector(Kind::glob, pattern); }
+
+		Kind kind() const { return _kind; }
+		const std::string& pattern() const { return _pattern; }
+
+		bool operator()(const Info* const ti) const;
+
+		// the matching half of operator(), applied to a category name
+		bool matches_category(const char* category_) const;
+
+	private:
+		Selector(const Kind kind_, const std::string& pattern_)
+			: _kind(kind_)
+			, _pattern(pattern_)
+		{}
+
+		Kind _kind;
+		std::string _pattern;
+	};
+
+	// Lookup tables over a fixed set of tests: a hash table on test names and one bucket per
+	// category, sorted so that prefix queries are a binary search. Globs are matched once per
+	// category rather than once per test. Results always come back in registration order.
+	class Registry_Index final
+	{
+	public:
+		typedef std::vector<const Info*> Container_Type;
+
+		explicit Registry_Index(const Container_Type& tests);
+
+		// the first registered test with the name, or nullptr
+		const Info* find(const char* name) const;
+		Container_Type select(const Selector& selector) const;
+		size_t size() const { return _tests.size(); }
+
+	private:
+		struct Bucket
+		{
+			std::string category;
+			std::vector<size_t> positions;		// into _tests, ascending
+		};
+
+		Container_Type _tests;
+		std::vector<size_t> _slots;			// open addressing on the name hash; npos is empty
+		std::vector<Bucket> _buckets;		// sorted by category
+	};
+
+	class Registry
+	{
+	public:
+		typedef std::vector<const Info*> Container_Type;
+		typedef std::function<std::chrono::nanoseconds(const Info*)> Estimate_Func;
+
+		virtual ~Registry();
+
+		static Registry& get();
+		void add(const Info* test)
+		{
+			sync().push_back(test);
+		}
+		Container_Type& tests() { return sync(); }
+
+		// Registers a test without touching the registry instance: the info is pushed onto an
+		// intrusive list whose head is zero-initialized, so this is safe during static
+		// initialization in any order and never allocates. tests() picks linked infos up lazily.
+		static void link(Info* info)
+		{
+			info->next = _linked;
+			_linked = info;
+		}
+
+		// the tests belonging to the shard, in registration order
+		Container_Type shard(const Shard& s) const;
+
+		// balances the shards by estimated duration instead of test count; tests the estimate
+		// knows nothing about (a zero duration) are costed at the mean of the known ones
+		Container_Type shard(const Shard& s, const Estimate_Func& estimate) const;
+
+		// Built on first use and rebuilt only if tests were registered since, which after static
+		// initialization means never. Like add(), not safe to call while tests are being registered.
+		const Registry_Index& index() const;
+
+		// the registered tests matching the selector, in registration order
+		Container_Type select(const Selector& selector) const
+		{
+			return index().select(selector);
+		}
+
+	protected:
+		Registry();		
+	private:
+		// appends whatever has been linked since the last call, keeping registration order
+		Container_Type& sync() const;
+
+		mutable Container_Type _tests;
+		mutable const Info* _synced;
+		mutable std::unique_ptr<Registry_Index> _index;
+		static const Info* _linked;
+		static std::unique_ptr<Registry> _instance;
+	};
+
+	// The source files changed since some base, as a filter predicate that selects the tests declared
+	// in a changed file or depending on one. Paths are compared by whole trailing components, so a
+	// repository-relative "tests/math.cpp" matches a test whose __FILE__ is "/work/repo/tests/math.cpp"
+	// or "../tests/math.cpp".
+	class Change_Set final
+	{
+	public:
+		Change_Set()
+			: _changed()
+			, _dependencies()
+		{}
+
+		void add(const std::string& path);
+
+		// one changed path per line
+		bool load(const std::string& path);
+
+		// the files `git diff --name-only base` reports for the work tree, plus untracked files
+		bool load_git_diff(const std::string& base = "HEAD", const std::string& repository = ".");
+
+		// declares that the tests in test_file also depend on dependency; either may be a glob
+		void depend(const std::string& test_file, const std::string& dependency);
+
+		// lines of "test_file: dependency dependency ...", '#' starting a comment
+		bool load_dependencies(const std::string& path);
+
+		bool changed(const char* file) const;
+		bool operator()(const Info* const ti) const;
+
+		bool empty() const { return _changed.empty(); }
+		size_t size() const { return _changed.size(); }
+
+	private:
+		struct Dependency
+		{
+			std::string test_file;
+			std::string dependency;
+		};
+
+		std::vector<std::string> _changed;			// normalized and sorted
+		std::vector<Dependency> _dependencies;
+	};
+
+	// Benchmark results saved from an earlier run, used to gate performance regressions.
+	class Baseline
+	{
+	public:
+		struct Entry
+		{
+			unsigned long long hash;
+			std::string name;
+			std::string category;
+			Benchmark_Stats stats;
+			Allocation_Stats allocations;	// recorded for tests that are not benchmarks or TEST_Ps
+			double instructions;			// from the hardware counters, per iteration for a benchmark; 0 if unknown
+		};
+
+		Baseline()
+			: threshold(0.10)
+			, significance(3.0)
+			, allocation_threshold(0.10)
+			, instruction_threshold(0.05)
+			, _mutex()
+			, _entries()
+		{}
+
+		bool load(const std::string& path);
+		bool save(const std::string& path) const;
+
+		// stores the benchmark statistics of a passing result, replacing any earlier entry for the
+		// test; allocation counts are stored the same way for other tests when they were tracked
+		void record(const Result& res);
+		bool find(const Info* ti, Benchmark_Stats& out_stats) const;
+		bool find(const Info* ti, Allocation_Stats& out_allocations) const;
+
+		// marks a passing benchmark as regressed when its median is more than `threshold` slower
+		// than the baseline and Welch's t statistic on the sample means exceeds `significance`,
+		// and a passing test when it allocated more than `allocation_threshold` more times; either
+		// is also regressed when it retired more than `instruction_threshold` more instructions
+		Status check(Result& res) const;
+
+		double threshold;		// relative median slowdown that counts as a regression, 0.10 is 10%
+		double significance;	// minimum t statistic, so ordinary noise doesn't fail the run
+		double allocation_threshold;	// relative growth in the allocation count that counts as a regression
+		double instruction_threshold;	// relative growth in the instruction count that counts as a regression
+
+	private:
+		// with _mutex held
+		const Entry* lookup(const Info* ti) const;
+		static bool tracks_allocations(const Result& res);
+		static bool tracks_instructions(const Result& res);
+		static Status mark_regressed(Result& res, const std::string& message);
+
+		mutable std::mutex _mutex;
+		std::vector<Entry> _entries;	// sorted by hash
+	};
+
+	// How long each test took in earlier runs, keyed by Shard::hash(). The file is a flat table of
+	// fixed-size records sorted by hash, in host byte order, so it loads with a single read (or can
+	// be mapped and binary searched by other tools). Tests that are not run keep their old entry,
+	// which lets sharded runs share one history.
+	class Duration_History
+	{
+	public:
+		struct Entry
+		{
+			unsigned long long hash;
+			long long nanoseconds;
+		};
+
+		Duration_History()
+			: smoothing(0.5)
+			, _mutex()
+			, _entries()
+		{}
+
+		bool load(const std::string& path);
+		bool save(const std::string& path) const;
+
+		// blends the duration of a test that ran into its entry: new = old + smoothing * (sample - old)
+		void record(const Result& res);
+
+		// zero for tests the history knows nothing about
+		std::chrono::nanoseconds estimate(const Info* ti) const;
+
+		// for Registry::shard() and anything else that takes an estimate
+		std::function<std::chrono::nanoseconds(const Info*)> estimator() const
+		{
+			return [this](const Info* ti) { return estimate(ti); };
+		}
+
+		size_t size() const;
+
+		double smoothing;		// weight of the newest sample, 1.0 keeps only the last run
+
+	private:
+		mutable std::mutex _mutex;
+		std::vector<Entry> _entries;	// sorted by hash
+	};
+
+	// The tests that failed on earlier runs, so the next run can start with them. Stored as a small
+	// text file of tab-separated category and name, one failing test per line.
+	class Failure_List
+	{
+	public:
+		struct Entry
+		{
+			unsigned long long hash;
+			std::string name;
+			std::string category;
+		};
+
+		Failure_List()
+			: _mutex()
+			, _entries()
+		{}
+
+		bool load(const std::string& path);
+		bool save(const std::string& path) const;
+
+		// adds a failed test and removes one that passed; tests that were not run are left alone
+		void record(const Result& res);
+		bool contains(const Info* ti) const;
+
+		// moves the listed tests to the front, otherwise keeping their order
+		void prioritize(std::vector<const Info*>& tests) const;
+
+		size_t size() const;
+
+	private:
+		mutable std::mutex _mutex;
+		std::vector<Entry> _entries;	// sorted by hash
+	};
+
+	enum class Observer_Delivery
+	{
+		serialized,		// observer is called on the thread that started the run, one result at a time
+		concurrent		// observer is called directly from the worker threads and must be thread-safe
+	};
+
+	struct Run_Options final
+	{
+		Run_Options()
+			: worker_count(0)
+			, observer_delivery(Observer_Delivery::serialized)
+			, compare_baseline(nullptr)
+			, record_baseline(nullptr)
+			, schedule_history(nullptr)
+			, record_history(nullptr)
+			, max_failures(0)
+			, failures_first(nullptr)
+			, record_failures(nullptr)
+			, timeout(0)
+			, abort_on_timeout(false)
+			, case_batch(0)
+			, suite_batch(0)
+			, fail_on_leak(false)
+			, async_concurrency(64)
+		{}
+
+		unsigned worker_count;		// 0 uses std::thread::hardware_concurrency()
+		Observer_Delivery observer_delivery;
+		const Baseline* compare_baseline;	// benchmarks slower than this are marked Status::regressed
+		Baseline* record_baseline;			// benchmark results are recorded here
+		const Duration_History* schedule_history;	// parallel and isolated runs start the longest tests first
+		Duration_History* record_history;			// test durations are recorded here
+		unsigned max_failures;		// stop starting tests once this many have failed; 0 runs everything
+		const Failure_List* failures_first;		// its tests run before all others
+		Failure_List* record_failures;			// failed tests are added here, passing ones removed
+		std::chrono::milliseconds timeout;	// limit for tests without their own; zero is unlimited
+		bool abort_on_timeout;		// in-process runs abort once a test overruns, since it can't be stopped
+		size_t case_batch;			// TEST_P cases handed to a parallel worker at a time; 0 picks for you
+		size_t suite_batch;			// tests of one suite handed to a parallel worker at a time; 0 spreads each suite over every worker
+		bool fail_on_leak;			// passing tests that leave allocations behind fail; needs UTEST_CPP_TRACK_ALLOCATIONS
+		size_t async_concurrency;	// coroutine tests each run_async() worker keeps in flight; 0 is unlimited
+	};
+
+	// How Runner::repeat() runs a single test over and over
+	struct Repeat_Options final
+	{
+		Repeat_Options()
+			: count(0)
+			, duration(0)
+			, cpu(-1)
+			, reuse_instance(false)
+			, evict_bytes(0)
+			, case_index(0)
+		{}
+
+		unsigned long long count;		// runs to make; with a duration as well, whichever ends first
+		std::chrono::milliseconds duration;	// keep running until this has passed; neither set runs once
+		int cpu;					// pin the calling thread to this core while repeating; -1 leaves it alone
+		bool reuse_instance;		// warm: one fixture instance for every run; cold: a new one each run
+		size_t evict_bytes;			// written over before every run to push the test's data out of the caches
+		size_t case_index;			// the case of a TEST_P to repeat
+	};
+
+	// What a repeated test did, across all of its runs. Times are nanoseconds of Result::duration.
+	struct Repeat_Stats final
+	{
+		Repeat_Stats()
+			: runs(0)
+			, passed(0)
+			, pinned(false)
+			, min(0)
+			, median(0)
+			, p90(0)
+			, p99(0)
+			, max(0)
+			, mean(0)
+			, stddev(0)
+			, histogram()
+			, first_failure()
+		{}
+
+		double pass_rate() const { return runs ? static_cast<double>(passed) / static_cast<double>(runs) : 0; }
+
+		unsigned long long runs;
+		unsigned long long passed;
+		bool pinned;				// whether the thread was pinned to Repeat_Options::cpu
+		double min;
+		double median;
+		double p90;
+		double p99;
+		double max;
+		double mean;
+		double stddev;
+		std::vector<unsigned long long> histogram;	// histogram[i] counts runs taking [2^i, 2^(i+1)) ns
+		Result first_failure;		// not_run when every run passed
+	};
+
+	namespace detail
+	{
+		// Storage that tests are constructed into, reused by every test run on the same thread. It
+		// only grows, so once the largest fixture has been seen running a test allocates nothing.
+		class Test_Arena final
+		{
+		public:
+			Test_Arena()
+				: _buffer()
+				, _capacity(0)
+				, _busy(false)
+			{}
+
+			bool busy() const { return _busy; }
+
+			void* acquire(const size_t size, const size_t align)
+			{
+				const size_t needed = size + align - 1;
+				if (needed > _capacity)
+				{
+					_capacity = needed > _capacity * 2 ? needed : _capacity * 2;
+					_buffer.reset(new unsigned char[_capacity]);
+				}
+				void* storage = _buffer.get();
+				size_t space = _capacity;
+				_busy = true;
+				return std::align(align, size, storage, space);
+			}
+
+			void release() { _busy = false; }
+
+		private:
+			std::unique_ptr<unsigned char[]> _buffer;
+			size_t _capacity;
+			bool _busy;
+		};
+
+		inline Test_Arena& test_arena()
+		{
+			static thread_local Test_Arena arena;
+			return arena;
+		}
+
+		// A registered test, constructed in this thread's arena when it is free and on the heap when
+		// it is not (a test that runs other tests from its body has the arena already).
+		class Test_Instance final
+		{
+		public:
+			explicit Test_Instance(const Info* ti)
+				: _test(nullptr)
+				, _owned()
+				, _in_arena(false)
+			{
+				// the fixture is built before its test starts counting, so neither it nor what its
+				// constructor allocates is charged to the test when it is destroyed
+				Allocation_Pause untracked;
+				auto& arena = test_arena();
+				if (ti->emplace && !arena.busy())
+				{
+					void* storage = arena.acquire(ti->size, ti->align);
+#if !UTEST_CPP_NO_EXCEPTIONS
+					try
+					{
+						_test = ti->emplace(storage);
+					}
+					catch (...)
+					{
+						arena.release();
+						throw;
+					}
+#else
+					_test = ti->emplace(storage);
+#endif
+					_in_arena = true;
+				}
+				else
+				{
+					_owned = ti->f();
+					_test = _owned.get();
+				}
+			}
+
+			~Test_Instance()
+			{
+				if (_in_arena)
+				{
+					_test->~Test();
+					test_arena().release();
+				}
+			}
+
+			Test_Instance(const Test_Instance&) = delete;
+			Test_Instance& operator=(const Test_Instance&) = delete;
+
+			Test& operator*() const { return *_test; }
+			Test* operator->() const { return _test; }
+
+		private:
+			Test* _test;
+			std::unique_ptr<Test> _owned;
+			bool _in_arena;
+		};
+	}
+
+	class Runner
+	{
+	public:
+		typedef const Info* const Info_Type;
+		typedef std::function<void(const Result&)> Observer_Func;
+
+		// for a TEST_P, runs the case named by out_res.case_index
+		static Status run(const Info* const ti, Result& out_res)
+		{
+#if UTEST_CPP_TRACK_ALLOCATIONS
+			// closed after the fixture is destroyed, so what the test keeps in its fixture isn't a leak
+			detail::Allocation_Scope allocations(out_res.allocations);
+#endif
+			detail::Test_Instance tst(ti);
+			out_res.info = ti;
+			tst->select_case(out_res.case_index);
+			return tst->execute(out_res);
+		}
+
+		// Runs under the watchdog when the test has a time limit. A thread can't be stopped from
+		// outside, so an overrunning test is reported on stderr as soon as it passes the limit and
+		// marked Status::timeout once it returns (or the process aborts, see abort_on_timeout).
+		static Status run(const Info* const ti, Result& out_res, const Run_Options& options);
+
+		template<typename Iterator_Type, class Execution_Observer>
+		static Status run(Iterator_Type itr_begin, Iterator_Type itr_end,
+			const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			return run(itr_begin, itr_end, [](Info_Type) { return true; }, observer, options);
+		}
+
+		template<typename Iterator_Type, class Binary_Predicate, class Execution_Observer>
+		static Status run(Iterator_Type itr_begin, Iterator_Type itr_end, const Binary_Predicate& filter,
+			const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			std::vector<const Info*> selected;
+			for (auto itr = itr_begin; itr != itr_end; ++itr)
+			{
+				if (filter(*itr))
+				{
+					selected.push_back(*itr);
+				}
+			}
+			if (options.failures_first)
+			{
+				options.failures_first->prioritize(selected);
+			}
+			detail::group_by_suite(selected);
+			return run_in_order(selected, observer, options);
+		}
+
+
+		template<typename Container_Type, class Execution_Observer>
+		static Status run(const Container_Type& tests, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return run(tests.begin(), tests.end(), observer, options);
+		}
+
+		template<typename Container_Type, class Binary_Predicate, class Execution_Observer>
+		static Status run(const Container_Type& tests, const Binary_Predicate& filter, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return run(tests.begin(), tests.end(), filter, observer, options);
+		}
+
+		template<class Execution_Observer>
+		static Status run_registered(const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			return run(Registry::get().tests(), [](Info_Type) { return true; }, observer, options);
+		}
+
+		template<class Binary_Predicate, class Execution_Observer>
+		static Status run_registered(const Binary_Predicate& filter, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return run(Registry::get().tests(), filter, observer, options);
+		}
+
+		// answered from the registry index rather than by filtering every registered test
+		template<class Execution_Observer>
+		static Status run_registered(const Selector& selector, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return run(Registry::get().select(selector), observer, options);
+		}
+
+		template<typename Iterator_Type, class Execution_Observer>
+		static Status run_parallel(Iterator_Type itr_begin, Iterator_Type itr_end,
+			const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			return run_parallel(itr_begin, itr_end, [](Info_Type) { return true; }, observer, options);
+		}
+
+		template<typename Iterator_Type, class Binary_Predicate, class Execution_Observer>
+		static Status run_parallel(Iterator_Type itr_begin, Iterator_Type itr_end, const Binary_Predicate& filter,
+			const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			std::vector<const Info*> selected;
+			for (auto itr = itr_begin; itr != itr_end; ++itr)
+			{
+				const auto* const ti = *itr;
+				if (filter(ti))
+				{
+					selected.push_back(ti);
+				}
+			}
+			return dispatch_parallel(selected, Observer_Func(observer), options);
+		}
+
+		template<typename Container_Type, class Execution_Observer>
+		static Status run_parallel(const Container_Type& tests, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return run_parallel(tests.begin(), tests.end(), observer, options);
+		}
+
+		template<typename Container_Type, class Binary_Predicate, class Execution_Observer>
+		static Status run_parallel(const Container_Type& tests, const Binary_Predicate& filter,
+			const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			return run_parallel(tests.begin(), tests.end(), filter, observer, options);
+		}
+
+		template<class Execution_Observer>
+		static Status run_registered_parallel(const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			return run_parallel(Registry::get().tests(), [](Info_Type) { return true; }, observer, options);
+		}
+
+		template<class Binary_Predicate, class Execution_Observer>
+		static Status run_registered_parallel(const Binary_Predicate& filter, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return run_parallel(Registry::get().tests(), filter, observer, options);
+		}
+
+		// answered from the registry index rather than by filtering every registered test
+		template<class Execution_Observer>
+		static Status run_registered_parallel(const Selector& selector, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return run_parallel(Registry::get().select(selector), observer, options);
+		}
+
+		// Each worker is a forked child process, so a crash only fails the test that was executing.
+		// Falls back to run_parallel() where UTEST_CPP_PROCESS_ISOLATION is unavailable.
+		template<typename Iterator_Type, class Execution_Observer>
+		static Status run_isolated(Iterator_Type itr_begin, Iterator_Type itr_end,
+			const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			return run_isolated(itr_begin, itr_end, [](Info_Type) { return true; }, observer, options);
+		}
+
+		template<typename Iterator_Type, class Binary_Predicate, class Execution_Observer>
+		static Status run_isolated(Iterator_Type itr_begin, Iterator_Type itr_end, const Binary_Predicate& filter,
+			const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			std::vector<const Info*> selected;
+			for (auto itr = itr_begin; itr != itr_end; ++itr)
+			{
+				const auto* const ti = *itr;
+				if (filter(ti))
+				{
+					selected.push_back(ti);
+				}
+			}
+			return dispatch_isolated(selected, Observer_Func(observer), options);
+		}
+
+		template<typename Container_Type, class Execution_Observer>
+		static Status run_isolated(const Container_Type& tests, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return run_isolated(tests.begin(), tests.end(), observer, options);
+		}
+
+		template<typename Container_Type, class Binary_Predicate, class Execution_Observer>
+		static Status run_isolated(const Container_Type& tests, const Binary_Predicate& filter,
+			const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			return run_isolated(tests.begin(), tests.end(), filter, observer, options);
+		}
+
+		template<class Execution_Observer>
+		static Status run_registered_isolated(const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			return run_isolated(Registry::get().tests(), [](Info_Type) { return true; }, observer, options);
+		}
+
+		template<class Binary_Predicate, class Execution_Observer>
+		static Status run_registered_isolated(const Binary_Predicate& filter, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return run_isolated(Registry::get().tests(), filter, observer, options);
+		}
+
+		// answered from the registry index rather than by filtering every registered test
+		template<class Execution_Observer>
+		static Status run_registered_isolated(const Selector& selector, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return run_isolated(Registry::get().select(selector), observer, options);
+		}
+
+#if UTEST_CPP_COROUTINES
+		// Coroutine tests are multiplexed on Run_Options::worker_count threads, each keeping up to
+		// async_concurrency of them suspended at once. Serial and exclusive ones, and every other test,
+		// then go to run_parallel().
+		template<typename Iterator_Type, class Execution_Observer>
+		static Status run_async(Iterator_Type itr_begin, Iterator_Type itr_end,
+			const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			return run_async(itr_begin, itr_end, [](Info_Type) { return true; }, observer, options);
+		}
+
+		template<typename Iterator_Type, class Binary_Predicate, class Execution_Observer>
+		static Status run_async(Iterator_Type itr_begin, Iterator_Type itr_end, const Binary_Predicate& filter,
+			const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			std::vector<const Info*> selected;
+			for (auto itr = itr_begin; itr != itr_end; ++itr)
+			{
+				const auto* const ti = *itr;
+				if (filter(ti))
+				{
+					selected.push_back(ti);
+				}
+			}
+			return dispatch_async(selected, Observer_Func(observer), options);
+		}
+
+		template<typename Container_Type, class Execution_Observer>
+		static Status run_async(const Container_Type& tests, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return run_async(tests.begin(), tests.end(), observer, options);
+		}
+
+		template<typename Container_Type, class Binary_Predicate, class Execution_Observer>
+		static Status run_async(const Container_Type& tests, const Binary_Predicate& filter,
+			const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			return run_async(tests.begin(), tests.end(), filter, observer, options);
+		}
+
+		template<class Execution_Observer>
+		static Status run_registered_async(const Execution_Observer& observer, const Run_Options& options = Run_Options())
+		{
+			return run_async(Registry::get().tests(), [](Info_Type) { return true; }, observer, options);
+		}
+
+		template<class Binary_Predicate, class Execution_Observer>
+		static Status run_registered_async(const Binary_Predicate& filter, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return run_async(Registry::get().tests(), filter, observer, options);
+		}
+
+		// answered from the registry index rather than by filtering every registered test
+		template<class Execution_Observer>
+		static Status run_registered_async(const Selector& selector, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return run_async(Registry::get().select(selector), observer, options);
+		}
+#endif
+
+		// applies the run-wide options (baselines and the like) to a finished result
+		static Status conclude(Result& res, const Run_Options& options)
+		{
+			const auto limit = time_limit(res.info, options);
+			if (limit.count() > 0 && res.duration > limit && res.status != Status::timeout)
+			{
+				mark_timeout(res, limit);
+			}
+			if (options.fail_on_leak && res.status == Status::pass && res.allocations.leaked_count)
+			{
+				mark_leak(res);
+			}
+			// compared before recording, so a baseline used for both still holds the previous numbers
+			// and a regressed result is not stored as the new baseline
+			if (options.compare_baseline)
+			{
+				options.compare_baseline->check(res);
+			}
+			if (options.record_baseline)
+			{
+				options.record_baseline->record(res);
+			}
+			if (options.record_history)
+			{
+				options.record_history->record(res);
+			}
+			if (options.record_failures)
+			{
+				options.record_failures->record(res);
+			}
+			return res.status;
+		}
+
+		// Runs one test again and again on the calling thread, for tracking down flaky tests or timing
+		// a single test. Every result is concluded with `options` and handed to the observer.
+		static Repeat_Stats repeat(const Info* const ti, const Repeat_Options& repeat, const Run_Options& options = Run_Options())
+		{
+			return repeat_test(ti, repeat, Observer_Func(), options);
+		}
+
+		template<class Execution_Observer>
+		static Repeat_Stats repeat(const Info* const ti, const Repeat_Options& repeat, const Execution_Observer& observer,
+			const Run_Options& options = Run_Options())
+		{
+			return repeat_test(ti, repeat, Observer_Func(observer), options);
+		}
+
+		// the test's own limit, or else the run-wide one
+		static std::chrono::milliseconds time_limit(const Info* const ti, const Run_Options& options)
+		{
+			return ti && ti->options.time_limit.count() > 0 ? ti->options.time_limit : options.timeout;
+		}
+
+	private:
+		template<class Execution_Observer>
+		static Status run_in_order(const std::vector<const Info*>& tests, const Execution_Observer& observer,
+			const Run_Options& options)
+		{
+			size_t pass(0), test_count(0);
+			auto deliver = [&](const Result& res)
+			{
+				if (res.status == Status::pass)
+				{
+					++pass;
+				}
+				++test_count;
+				observer(res);
+			};
+			// tests that were never started are not reported
+			auto cancelled = [&]() { return options.max_failures && test_count - pass >= options.max_failures; };
+
+			for (size_t i = 0; i < tests.size() && !cancelled(); ++i)
+			{
+				const auto* const ti = tests[i];
+				if (!ti->parameterized())
+				{
+					Result res;
+					run(ti, res, options);
+					deliver(res);
+				}
+				else
+				{
+					// every case of a TEST_P shares one instance
+					run_on_instance(ti, 0, ti->case_count(), 0, options, cancelled, deliver);
+				}
+				// the tests are grouped by suite, so this was the last one to need its context
+				if (ti->suite && (cancelled() || i + 1 == tests.size() || tests[i + 1]->suite != ti->suite))
+				{
+					detail::Suite_Cache::get().release(ti->suite);
+				}
+			}
+			return pass == test_count ? Status::pass : Status::fail;
+		}
+
+		static void mark_timeout(Result& res, const std::chrono::milliseconds limit);
+		static void mark_leak(Result& res);
+
+		// Runs cases [case_begin, case_end) of a TEST_P on one instance, or the test itself, and hands
+		// each concluded result to deliver. With allocation tracking the results are concluded once the
+		// instance has been destroyed, so memory its fixture holds on to from one case to the next isn't
+		// taken for a leak; until then their failures don't count towards cancelled().
+		template<class Cancelled, class Deliver>
+		static void run_on_instance(const Info* const ti, const size_t case_begin, const size_t case_end, const unsigned worker,
+			const Run_Options& options, const Cancelled& cancelled, const Deliver& deliver)
+		{
+#if UTEST_CPP_TRACK_ALLOCATIONS
+			std::vector<std::unique_ptr<Result>> finished;
+			{
+				Allocation_Stats shared;
+				detail::Allocation_Scope allocations(shared, true);
+				detail::Test_Instance tst(ti);
+				for (size_t c = case_begin; c < case_end && !cancelled(); ++c)
+				{
+					finished.emplace_back(new Result());
+					Result& res = *finished.back();
+					res.case_index = c;
+					res.worker = worker;
+					execute_case(*tst, ti, res, options);
+				}
+			}
+			for (auto& res : finished)
+			{
+				conclude(*res, options);
+				deliver(*res);
+			}
+#else
+			detail::Test_Instance tst(ti);
+			for (size_t c = case_begin; c < case_end && !cancelled(); ++c)
+			{
+				Result res;
+				res.case_index = c;
+				res.worker = worker;
+				execute_case(*tst, ti, res, options);
+				conclude(res, options);
+				deliver(res);
+			}
+#endif
+		}
+
+		// runs case res.case_index on an existing instance, under the watchdog; conclude() is left to the caller
+		static void execute_case(Test& tst, const Info* const ti, Result& res, const Run_Options& options);
+
+		static Repeat_Stats repeat_test(const Info* const ti, const Repeat_Options& repeat, const Observer_Func& observer,
+			const Run_Options& options);
+		static Status dispatch_parallel(const std::vector<const Info*>& tests, const Observer_Func& observer,
+			const Run_Options& options);
+		static Status dispatch_isolated(const std::vector<const Info*>& tests, const Observer_Func& observer,
+			const Run_Options& options);
+#if UTEST_CPP_COROUTINES
+		static Status dispatch_async(const std::vector<const Info*>& tests, const Observer_Func& observer,
+			const Run_Options& options);
+#endif
+	};
+
+	// Base of the built-in reporters. Output is formatted into an in-memory buffer and written to the
+	// stream only when the buffer fills, when flush_interval has passed since the last write or when
+	// the run is finished, so reporting costs no I/O per test. Results may be delivered from several
+	// threads at once (Observer_Delivery::concurrent). Reporters are not copyable: pass observer()
+	// (or std::ref) to the runner.
+	class Reporter
+	{
+	public:
+		static const size_t buffer_capacity = 64 * 1024;
+
+		explicit Reporter(std::ostream& os,
+			const std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000));
+		// writes to a file, which is truncated; check good() afterwards
+		explicit Reporter(const std::string& path,
+			const std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000));
+		virtual ~Reporter();
+
+		Reporter(const Reporter&) = delete;
+		Reporter& operator=(const Reporter&) = delete;
+
+		void operator()(const Result& res);
+
+		std::function<void(const Result&)> observer()
+		{
+			return [this](const Result& res) { (*this)(res); };
+		}
+
+		// writes the footer and flushes; later results are ignored. Called by the destructor of each
+		// built-in reporter, so it only needs calling explicitly to read the output before then.
+		void finish();
+
+		bool good() const;
+
+	protected:
+		virtual void write_header(std::string&) {}
+		virtual void write_result(std::string& out, const Result& res) = 0;
+		virtual void write_footer(std::string&) {}
+
+	private:
+		void start();
+		void flush();
+
+		std::unique_ptr<std::ostream> _file;
+		std::ostream* _os;
+		std::string _buffer;
+		const std::chrono::milliseconds _flush_interval;
+		std::chrono::steady_clock::time_point _last_flush;
+		bool _started;
+		bool _finished;
+		mutable std::mutex _mutex;
+	};
+
+	// <testsuites><testsuite name="utest"> with one <testcase> per result, classname being the category;
+	// a timeout is an <error>, the other failures a <failure>. Test cases are written as they come, so
+	// the suite carries no totals, which JUnit consumers count for themselves.
+	class Junit_Reporter final : public Reporter
+	{
+	public:
+		explicit Junit_Reporter(std::ostream& os,
+			const std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000))
+			: Reporter(os, flush_interval)
+		{}
+		explicit Junit_Reporter(const std::string& path,
+			const std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000))
+			: Reporter(path, flush_interval)
+		{}
+		~Junit_Reporter() override { finish(); }
+
+	private:
+		void write_header(std::string& out) override;
+		void write_result(std::string& out, const Result& res) override;
+		void write_footer(std::string& out) override;
+	};
+
+	// TAP version 13, with the plan at the end and failures as YAML diagnostics
+	class Tap_Reporter final : public Reporter
+	{
+	public:
+		explicit Tap_Reporter(std::ostream& os,
+			const std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000))
+			: Reporter(os, flush_interval)
+			, _count(0)
+		{}
+		explicit Tap_Reporter(const std::string& path,
+			const std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000))
+			: Reporter(path, flush_interval)
+			, _count(0)
+		{}
+		~Tap_Reporter() override { finish(); }
+
+	private:
+		void write_header(std::string& out) override;
+		void write_result(std::string& out, const Result& res) override;
+		void write_footer(std::string& out) override;
+
+		size_t _count;
+	};
+
+	// one JSON object per line and per result
+	class Json_Lines_Reporter final : public Reporter
+	{
+	public:
+		explicit Json_Lines_Reporter(std::ostream& os,
+			const std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000))
+			: Reporter(os, flush_interval)
+		{}
+		explicit Json_Lines_Reporter(const std::string& path,
+			const std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000))
+			: Reporter(path, flush_interval)
+		{}
+		~Json_Lines_Reporter() override { finish(); }
+
+	private:
+		void write_result(std::string& out, const Result& res) override;
+	};
+
+	// One result as a Result_Log stores it. The strings point into the log's file mapping.
+	struct Result_Log_Entry final
+	{
+		struct Failure_Entry
+		{
+			const char* message;
+			const char* file;
+			int line;
+		};
+
+		Result_Log_Entry()
+			: name("")
+			, category("")
+			, file("")
+			, line(0)
+			, case_index(0)
+			, status(Status::not_run)
+			, worker(0)
+			, started(0)
+			, duration(0)
+			, setup_duration(0)
+			, test_duration(0)
+			, teardown_duration(0)
+			, benchmark()
+			, allocations()
+			, counters()
+			, failures()
+		{}
+
+		const char* name;
+		const char* category;
+		const char* file;
+		int line;
+		size_t case_index;
+		Status status;
+		unsigned worker;
+		std::chrono::nanoseconds started;	// since the first result its writer saw
+		std::chrono::nanoseconds duration;
+		std::chrono::nanoseconds setup_duration;
+		std::chrono::nanoseconds test_duration;
+		std::chrono::nanoseconds teardown_duration;
+		Benchmark_Stats benchmark;
+		Allocation_Stats allocations;
+		Counter_Stats counters;
+		std::vector<Failure_Entry> failures;
+	};
+
+	namespace detail
+	{
+		class Result_Log_Encoder;
+		class Result_Log_Cursor;
+	}
+
+	// A compact binary log of results, for runs with far too many of them to keep as XML or JSON:
+	// names, files and failure messages go in a string table and numbers are varints. The log is a
+	// stream of records, so the file of a run that crashed stays readable up to its last full record.
+	class Result_Log_Reporter final : public Reporter
+	{
+	public:
+		explicit Result_Log_Reporter(std::ostream& os,
+			const std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000));
+		explicit Result_Log_Reporter(const std::string& path,
+			const std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000));
+		~Result_Log_Reporter() override;
+
+	private:
+		void write_header(std::string& out) override;
+		void write_result(std::string& out, const Result& res) override;
+
+		std::unique_ptr<detail::Result_Log_Encoder> _encoder;
+	};
+
+	// Reads a file written by Result_Log_Reporter or merge() through a read-only memory mapping.
+	// Entries refer to the strings in the file itself, so reading a log copies none of them.
+	class Result_Log final
+	{
+	public:
+		typedef Result_Log_Entry Entry;
+
+		Result_Log();
+		~Result_Log();
+
+		Result_Log(const Result_Log&) = delete;
+		Result_Log& operator=(const Result_Log&) = delete;
+
+		// false if the file can't be read or isn't a result log; a cut-off last record is ignored
+		bool open(const std::string& path);
+		void close();
+
+		size_t size() const { return _results; }
+
+		// every result in the order it was written; the entry is reused from one call to the next
+		void for_each(const std::function<void(const Entry&)>& func) const;
+
+		// Writes the results of every input, in order, into one log with a single string table.
+		// Records are translated rather than formatted, so merging shards costs little more than a copy.
+		static bool merge(const std::vector<std::string>& inputs, const std::string& output);
+
+	private:
+		struct Test_Definition
+		{
+			const char* name;
+			const char* category;
+			const char* file;
+			int line;
+		};
+
+		// like for_each(), along with the index of each entry's test in _tests
+		void scan(const std::function<void(const Entry&, size_t)>& func) const;
+		bool decode(detail::Result_Log_Cursor& cursor, Entry& entry, size_t& test) const;
+		const char* string_at(const unsigned long long id) const;
+
+		const unsigned char* _data;
+		size_t _size;			// of the part of the file holding whole records
+		void* _mapping;
+		size_t _mapped;
+		std::vector<unsigned char> _copy;	// where there is no mmap()
+		std::vector<const char*> _strings;
+		std::vector<Test_Definition> _tests;
+		size_t _results;
+	};
+
+	// Keeps when each test and each of its phases ran, and on which worker, and writes the run as
+	// Chrome trace-event JSON for chrome://tracing or the Perfetto UI. Every thread that delivers
+	// results appends to a buffer of its own, so recording takes no lock even with concurrent
+	// observers after the thread's first result.
+	class Trace_Recorder final
+	{
+	public:
+		Trace_Recorder();
+
+		Runner::Observer_Func observer()
+		{
+			return [this](const Result& res) { record(res); };
+		}
+
+		void record(const Result& res);
+
+		// once the run is over; times are relative to the first test that started
+		bool write(std::ostream& os) const;
+		bool save(const std::string& path) const;
+		size_t size() const;
+
+	private:
+		struct Event
+		{
+			const Info* info;
+			size_t case_index;
+			Status status;
+			unsigned worker;
+			std::chrono::steady_clock::time_point started;
+			std::chrono::nanoseconds setup_duration;
+			std::chrono::nanoseconds test_duration;
+			std::chrono::nanoseconds teardown_duration;
+		};
+
+		typedef std::vector<Event> Buffer;
+
+		Buffer& local_buffer();
+
+		unsigned long long _id;		// tells a thread's cached buffer apart from one of an earlier recorder
+		mutable std::mutex _mutex;	// held only to add a thread's buffer
+		std::vector<std::unique_ptr<Buffer>> _buffers;
+	};
+
+#ifdef UTEST_CPP_IMPLEMENTATION
+
+	namespace detail
+	{
+		void write_value(std::ostream& os, const bool value) { os << value; }
+		void write_value(std::ostream& os, const char value) { os << value; }
+		void write_value(std::ostream& os, const signed char value) { os << value; }
+		void write_value(std::ostream& os, const unsigned char value) { os << value; }
+		void write_value(std::ostream& os, const long long value) { os << value; }
+		void write_value(std::ostream& os, const unsigned long long value) { os << value; }
+		void write_value(std::ostream& os, const double value) { os << value; }
+		void write_value(std::ostream& os, const long double value) { os << value; }
+		void write_value(std::ostream& os, const char* value) { os << value; }
+		void write_value(std::ostream& os, const signed char* value) { os << value; }
+		void write_value(std::ostream& os, const unsigned char* value) { os << value; }
+		void write_value(std::ostream& os, const void* value) { os << value; }
+		void write_value(std::ostream& os, const std::string& value) { os << value; }
+
+		void write_comparison(std::ostream& os, const char* prefix, const Write_Operand_Func write_first, const void* first,
+			const Write_Operand_Func write_second, const void* second)
+		{
+			os << prefix;
+			write_first(os, first);
+			os << "] saw [";
+			write_second(os, second);
+			os << "]";
+		}
+
+		std::string format_comparison(const Write_Comparison_Func write, const char* prefix, const void* first,
+			const void* second)
+		{
+			std::ostringstream os;
+			write(os, prefix, first, second);
+			return os.str();
+		}
+
+		Failure near_failure(const double expected, const double actual, const int digits, const unsigned long long distance,
+			const Tolerance& tol, const char* file_name, const int line_num)
+		{
+			std::ostringstream os;
+			os.precision(digits);
+			os << "Expected [" << expected << "] saw [" << actual << "]: ";
+			if (distance == ~0ULL)
+			{
+				os << "not a number";
+			}
+			else if (std::isinf(expected) || std::isinf(actual))
+			{
+				os << "infinity is only near itself";
+			}
+			else
+			{
+				os << distance << " ulps apart";
+			}
+			os << ", tolerance " << tol.max_ulps << " ulps";
+			if (tol.epsilon > 0)
+			{
+				os << " or " << tol.epsilon;
+			}
+			return Failure::message(os.str(), file_name, line_num);
+		}
+
+		std::string format_mismatch(const Mismatch_Window& window)
+		{
+			auto write_window = [&window](std::ostream& os, const Write_Operand_Func write, const void* const* values,
+				const size_t count, const size_t size)
+			{
+				os << "[";
+				if (window.first > 0)
+				{
+					os << "..." << window.separator;
+				}
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (i)
+					{
+						os << window.separator;
+					}
+					write(os, values[i]);
+				}
+				if (window.first + count < size)
+				{
+					os << window.separator << "...";
+				}
+				os << "]";
+			};
+
+			std::ostringstream os;
+			os << window.what << " " << window.index;
+			if (window.expected_size != window.actual_size)
+			{
+				os << " (expected size " << window.expected_size << ", saw " << window.actual_size << ")";
+			}
+			else
+			{
+				os << " of " << window.expected_size;
+			}
+			os << ": expected ";
+			write_window(os, window.write_expected, window.expected, window.expected_count, window.expected_size);
+			os << " saw ";
+			write_window(os, window.write_actual, window.actual, window.actual_count, window.actual_size);
+			return os.str();
+		}
+
+		void write_byte(std::ostream& os, const void* value)
+		{
+			static const char digits[] = "0123456789abcdef";
+			const unsigned char byte = *static_cast<const unsigned char*>(value);
+			os << digits[byte >> 4] << digits[byte & 0xf];
+		}
+
+		std::string describe_memory_mismatch(const unsigned char* expected, const unsigned char* actual, const size_t size)
+		{
+			Mismatch_Window window("Memory differs at offset", " ", &write_byte, &write_byte);
+			window.index = static_cast<size_t>(std::mismatch(expected, expected + size, actual).first - expected);
+			window.first = window.index > Mismatch_Window::radius ? window.index - Mismatch_Window::radius : 0;
+			window.expected_size = window.actual_size = size;
+			window.expected_count = window.actual_count = std::min(size - window.first, Mismatch_Window::radius * 2 + 1);
+			for (size_t i = 0; i < window.expected_count; ++i)
+			{
+				window.expected[i] = expected + window.first + i;
+				window.actual[i] = actual + window.first + i;
+			}
+			return format_mismatch(window);
+		}
+
+		void invalid_range_step()
+		{
+			std::fprintf(stderr, "utest::range: a step of zero never reaches the end of the range\n");
+			std::abort();
+		}
+
+#if UTEST_CPP_NO_EXCEPTIONS
+		void abort_test(const Failure& failure)
+		{
+			Result* res = current_result();
+			std::jmp_buf* point = current_abort_point();
+			if (res && point)
+			{
+				res->fail(failure);
+				std::longjmp(*point, 1);
+			}
+			std::fprintf(stderr, "%s(%d): assert failed outside of a test: %s\n", failure.file(), failure.line(),
+				failure.str().c_str());
+			std::abort();
+		}
+#endif
+	}
+
+	void Failure::write(std::ostream& os) const
+	{
+		if (_format)
+		{
+			_format(os, _text, _operands);
+		}
+		else if (_text)
+		{
+			os << _text;
+		}
+		else
+		{
+			os << _owned;
+		}
+	}
+
+	std::string Failure::formatted() const
+	{
+		std::ostringstream os;
+		write(os);
+		return os.str();
+	}
+
+	void Expect_Fail_Handler::handle(const Failure& failure)
+	{
+		if (Result* res = detail::current_result())
+		{
+			res->fail(failure);
+			return;
+		}
+		Default_Fail_Handler::handle(failure);
+	}
+
+	Status Test::execute(Result& res)
+	{
+		const auto test_start_time = std::chrono::steady_clock::now();
+		auto phase_start_time = test_start_time;
+		res.started = test_start_time;
+		auto lap = [&phase_start_time]()
+		{
+			const auto now = std::chrono::steady_clock::now();
+			const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - phase_start_time);
+			phase_start_time = now;
+			return elapsed;
+		};
+
+		struct Context_Scope
+		{
+			explicit Context_Scope(Result* res) : previous(detail::current_result()) { detail::current_result() = res; }
+			~Context_Scope() { detail::current_result() = previous; }
+			Result* previous;
+		} context(&res);
+#if UTEST_CPP_TRACK_ALLOCATIONS
+		detail::Allocation_Scope allocations(res.allocations);
+#endif
+
+		// a failure is charged to whichever phase was running when it happened
+		auto* phase = &res.setup_duration;
+#if UTEST_CPP_NO_EXCEPTIONS
+		if (guarded(&Test::pre_test))
+		{
+			*phase = lap();
+			phase = &res.test_duration;
+#if UTEST_CPP_PERF_COUNTERS
+			// the jump out of a failed assert skips destructors in the body, so the counters are read out here
+			detail::Counter_Scope counters(res.counters);
+			const bool completed = guarded(&Test::measured_execute_test);
+			counters.stop();
+#else
+			const bool completed = guarded(&Test::measured_execute_test);
+#endif
+			if (completed && res.failures.empty())
+			{
+				res.status = Status::pass;
+			}
+		}
+		*phase = lap();
+		guarded(&Test::post_test);
+#else
+		try
+		{
+			pre_test();
+			*phase = lap();
+			phase = &res.test_duration;
+			measured_execute_test();
+			if (res.failures.empty())
+			{
+				res.status = Status::pass;
+			}
+		}
+		catch (const assert_fail_exception& ex)
+		{
+			res.fail(ex.failure());
+		}
+		catch (const std::exception& ex)
+		{
+			res.exception(ex);
+		}
+		*phase = lap();
+		post_test();
+#endif
+#if UTEST_CPP_TRACK_ALLOCATIONS
+		allocations.stop();
+#endif
+		res.teardown_duration = lap();
+		res.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(phase_start_time - test_start_time);
+		report(res);
+		return res.status;
+	}
+
+	void Test::measured_execute_test()
+	{
+#if UTEST_CPP_PERF_COUNTERS && !UTEST_CPP_NO_EXCEPTIONS
+		detail::Counter_Scope counters(detail::current_result()->counters);
+#endif
+		execute_test();
+	}
+
+#if UTEST_CPP_NO_EXCEPTIONS
+	bool Test::guarded(void (Test::*phase)())
+	{
+		std::jmp_buf point;
+		std::jmp_buf* const previous = detail::current_abort_point();
+		detail::current_abort_point() = &point;
+		if (setjmp(point) != 0)
+		{
+			detail::current_abort_point() = previous;
+			return false;
+		}
+		(this->*phase)();
+		detail::current_abort_point() = previous;
+		return true;
+	}
+#endif
+
+	Auto_Registered_Test::Auto_Registered_Test(Info* info)
+		: _info(info)
+	{
+		Registry::link(info);
+	}
+
+	Auto_Registered_Test::Auto_Registered_Test(const Info* info)
+		: _info(info)
+	{
+		Registry::get().add(info);
+	}
+
+	namespace detail
+	{
+		class Concrete_Registry : public Registry {};
+
+		// A contiguous run of the schedule executed in order by a single worker.
+		// A run of tests, or a batch of the cases of one TEST_P. case_end of zero means every case,
+		// which is how a TEST_P inside a chain or on its own serial slot runs.
+		struct Task
+		{
+			size_t begin;
+			size_t end;
+			size_t case_begin;
+			size_t case_end;
+		};
+
+		// A worker's own queue. The owner pops from the front to keep registration order,
+		// idle workers steal from the back so they take work the owner would reach last.
+		class Work_Queue
+		{
+		public:
+			void push(const Task& task)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_items.push_back(task);
+			}
+
+			bool pop(Task& out_task)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (_items.empty())
+				{
+					return false;
+				}
+				out_task = _items.front();
+				_items.pop_front();
+				return true;
+			}
+
+			bool steal(Task& out_task)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (_items.empty())
+				{
+					return false;
+				}
+				out_task = _items.back();
+				_items.pop_back();
+				return true;
+			}
+
+		private:
+			std::mutex _mutex;
+			std::deque<Task> _items;
+		};
+
+		// Orders the tests for the pool: each exclusive group becomes one task so its members
+		// never overlap, every parallel test is a task of its own and serial tests are held back.
+		// Tests sharing a suite are kept together, and in parallel runs they are split into one
+		// task per worker, so each worker builds the suite's context once.
+		class Schedule
+		{
+		public:
+			static const size_t no_suite = static_cast<size_t>(-1);
+
+			// with an estimate, tasks are ordered longest first (exclusive chains costing the sum of
+			// their tests) and cost() is filled in; otherwise chains come first in registration order
+			// parallel TEST_P cases are split into batches so that each worker gets several of them
+			Schedule(const std::vector<const Info*>& tests, const Registry::Estimate_Func& estimate,
+				const Failure_List* failed, const unsigned worker_hint, const size_t case_batch,
+				const size_t suite_batch)
+			{
+				std::vector<std::pair<const char*, std::vector<const Info*>>> groups;
+				std::vector<const Info*> parallel;
+				for (const auto* ti : tests)
+				{
+					switch (ti->options.concurrency)
+					{
+					case Concurrency::serial:
+						_serial.push_back(ti);
+						break;
+					case Concurrency::exclusive:
+						{
+							const char* group = ti->options.exclusive_group ? ti->options.exclusive_group : "";
+							auto itr = groups.begin();
+							while (itr != groups.end() && std::strcmp(itr->first, group) != 0)
+							{
+								++itr;
+							}
+							if (itr == groups.end())
+							{
+								groups.emplace_back(group, std::vector<const Info*>());
+								itr = groups.end() - 1;
+							}
+							itr->second.push_back(ti);
+						}
+						break;
+					default:
+						parallel.push_back(ti);
+						break;
+					}
+				}
+
+				// chains go first so the longest tasks don't end up at the tail of the run
+				for (auto& group : groups)
+				{
+					group_by_suite(group.second);
+					const size_t begin = _tests.size();
+					_tests.insert(_tests.end(), group.second.begin(), group.second.end());
+					_tasks.push_back(Task{ begin, _tests.size(), 0, 0 });
+				}
+				group_by_suite(parallel);
+				const size_t workers = worker_hint ? worker_hint : 1;
+				for (size_t p = 0; p < parallel.size(); ++p)
+				{
+					const auto* ti = parallel[p];
+					_tests.push_back(ti);
+					const size_t index = _tests.size() - 1;
+					if (ti->suite && !ti->parameterized())
+					{
+						// a suite's tests are contiguous after grouping; deal them out in equal chunks
+						size_t count = 1;
+						while (p + count < parallel.size() && parallel[p + count]->suite == ti->suite
+							&& !parallel[p + count]->parameterized())
+						{
+							++count;
+						}
+						_tests.insert(_tests.end(), parallel.begin() + static_cast<std::ptrdiff_t>(p + 1),
+							parallel.begin() + static_cast<std::ptrdiff_t>(p + count));
+						const size_t chunk = suite_batch ? suite_batch : (count + workers - 1) / workers;
+						for (size_t c = 0; c < count; c += chunk)
+						{
+							_tasks.push_back(Task{ index + c, index + std::min(count, c + chunk), 0, 0 });
+						}
+						p += count - 1;
+						continue;
+					}
+					if (!ti->parameterized())
+					{
+						_tasks.push_back(Task{ index, index + 1, 0, 0 });
+						continue;
+					}
+					const size_t cases = ti->case_count();
+					size_t batch = case_batch;
+					if (batch == 0)
+					{
+						// about four batches per worker, so stealing can still even out the load
+						const size_t slots = workers * 4;
+						batch = std::min<size_t>(256, std::max<size_t>(1, (cases + slots - 1) / slots));
+					}
+					for (size_t c = 0; c < cases; c += batch)
+					{
+						_tasks.push_back(Task{ index, index + 1, c, std::min(cases, c + batch) });
+					}
+				}
+				if (estimate)
+				{
+					order_longest_first(estimate);
+				}
+				if (failed)
+				{
+					order_failed_first(*failed);
+				}
+				group_by_suite(_serial);
+
+				for (const auto* ti : _tests)
+				{
+					size_t slot = no_suite;
+					if (ti->suite)
+					{
+						slot = static_cast<size_t>(std::find(_suites.begin(), _suites.end(), ti->suite) - _suites.begin());
+						if (slot == _suites.size())
+						{
+							_suites.push_back(ti->suite);
+						}
+					}
+					_suite_slots.push_back(slot);
+				}
+			}
+
+			const std::vector<const Info*>& tests() const { return _tests; }
+			const std::vector<Task>& tasks() const { return _tasks; }
+			const std::vector<const Info*>& serial() const { return _serial; }
+
+			// the distinct suites of the pooled tests, and which of them each entry of tests() uses
+			const std::vector<const Suite_Info*>& suites() const { return _suites; }
+			size_t suite_slot(const size_t test) const { return _suite_slots[test]; }
+
+			// estimated nanoseconds per task, empty when there was no estimate
+			const std::vector<long long>& costs() const { return _costs; }
+
+		private:
+			void order_longest_first(const Registry::Estimate_Func& estimate)
+			{
+				// unknown tests are costed at the mean of the known ones, as Registry::shard() does
+				std::vector<long long> test_costs(_tests.size());
+				long long known_total = 0;
+				long long known_count = 0;
+				for (size_t i = 0; i < _tests.size(); ++i)
+				{
+					test_costs[i] = static_cast<long long>(estimate(_tests[i]).count());
+					if (test_costs[i] > 0)
+					{
+						known_total += test_costs[i];
+						++known_count;
+					}
+				}
+				const long long fallback = known_count ? known_total / known_count : 1;
+
+				std::vector<std::pair<long long, Task>> costed;
+				costed.reserve(_tasks.size());
+				for (const auto& task : _tasks)
+				{
+					// durations are recorded per result, so a TEST_P costs one estimate per case
+					long long cost = 0;
+					for (size_t i = task.begin; i < task.end; ++i)
+					{
+						const long long each = test_costs[i] > 0 ? test_costs[i] : fallback;
+						const size_t cases = !_tests[i]->parameterized() ? 1
+							: task.case_end ? task.case_end - task.case_begin : _tests[i]->case_count();
+						cost += each * static_cast<long long>(cases);
+					}
+					costed.emplace_back(cost, task);
+				}
+				std::stable_sort(costed.begin(), costed.end(),
+					[](const std::pair<long long, Task>& a, const std::pair<long long, Task>& b) { return a.first > b.first; });
+
+				_costs.clear();
+				for (size_t i = 0; i < costed.size(); ++i)
+				{
+					_tasks[i] = costed[i].second;
+					_costs.push_back(costed[i].first);
+				}
+			}
+
+			// tasks holding a previously failed test move to the front, keeping the order otherwise
+			void order_failed_first(const Failure_List& failed)
+			{
+				std::vector<size_t> order(_tasks.size());
+				for (size_t i = 0; i < order.size(); ++i)
+				{
+					order[i] = i;
+				}
+				auto has_failed = [&](const size_t t)
+				{
+					for (size_t i = _tasks[t].begin; i < _tasks[t].end; ++i)
+					{
+						if (failed.contains(_tests[i]))
+						{
+							return true;
+						}
+					}
+					return false;
+				};
+				std::stable_partition(order.begin(), order.end(), has_failed);
+
+				std::vector<Task> tasks;
+				std::vector<long long> costs;
+				for (const size_t t : order)
+				{
+					tasks.push_back(_tasks[t]);
+					if (!_costs.empty())
+					{
+						costs.push_back(_costs[t]);
+					}
+				}
+				_tasks.swap(tasks);
+				_costs.swap(costs);
+				failed.prioritize(_serial);
+			}
+
+			std::vector<const Info*> _tests;
+			std::vector<Task> _tasks;
+			std::vector<long long> _costs;
+			std::vector<const Info*> _serial;
+			std::vector<const Suite_Info*> _suites;
+			std::vector<size_t> _suite_slots;
+		};
+
+		inline Registry::Estimate_Func history_estimate(const Run_Options& options)
+		{
+			if (!options.schedule_history)
+			{
+				return Registry::Estimate_Func();
+			}
+			return options.schedule_history->estimator();
+		}
+
+		class Thread_Group
+		{
+		public:
+			~Thread_Group()
+			{
+				join();
+			}
+
+			template<class Func>
+			void spawn(Func&& func)
+			{
+				_threads.emplace_back(std::forward<Func>(func));
+			}
+
+			void join()
+			{
+				for (auto& t : _threads)
+				{
+					if (t.joinable())
+					{
+						t.join();
+					}
+				}
+			}
+
+		private:
+			std::vector<std::thread> _threads;
+		};
+
+		inline unsigned requested_worker_count(const Run_Options& options)
+		{
+			unsigned count = options.worker_count;
+			if (count == 0)
+			{
+				count = std::thread::hardware_concurrency();
+			}
+			return count ? count : 1;
+		}
+
+		inline unsigned resolve_worker_count(const Run_Options& options, const size_t task_count)
+		{
+			unsigned count = requested_worker_count(options);
+			if (count > task_count)
+			{
+				count = static_cast<unsigned>(task_count);
+			}
+			return count;
+		}
+
+		// Hands the results of a pool of workers to the observer. Serialized delivery queues them for the
+		// thread that started the run, which calls drain() until every worker has called finished().
+		class Result_Channel final
+		{
+		public:
+			Result_Channel(const std::function<void(const Result&)>& observer, const Observer_Delivery delivery,
+				const unsigned producers)
+				: _observer(observer)
+				, _serialized(delivery == Observer_Delivery::serialized)
+				, _mutex()
+				, _cv()
+				, _completed()
+				, _producers(producers)
+			{}
+
+			void deliver(Result& res)
+			{
+				if (!_serialized)
+				{
+					_observer(res);
+					return;
+				}
+				std::lock_guard<std::mutex> lock(_mutex);
+				_completed.push_back(std::move(res));
+				_cv.notify_one();
+			}
+
+			void finished()
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				--_producers;
+				_cv.notify_one();
+			}
+
+			void drain()
+			{
+				if (!_serialized)
+				{
+					return;
+				}
+				std::deque<Result> batch;
+				std::unique_lock<std::mutex> lock(_mutex);
+				for (;;)
+				{
+					_cv.wait(lock, [this]() { return !_completed.empty() || _producers == 0; });
+					if (_completed.empty())
+					{
+						break;
+					}
+					batch.swap(_completed);
+					lock.unlock();
+					for (const auto& res : batch)
+					{
+						_observer(res);
+					}
+					batch.clear();
+					lock.lock();
+				}
+			}
+
+		private:
+			const std::function<void(const Result&)>& _observer;
+			const bool _serialized;
+			std::mutex _mutex;
+			std::condition_variable _cv;
+			std::deque<Result> _completed;
+			unsigned _producers;
+		};
+
+		// One thread for the whole process that watches the deadlines of the in-process tests that
+		// are running. It is started by the first test with a time limit and stopped at exit.
+		class Watchdog
+		{
+		public:
+			static Watchdog& get()
+			{
+				static Watchdog watchdog;
+				return watchdog;
+			}
+
+			~Watchdog()
+			{
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					_stopping = true;
+				}
+				_cv.notify_one();
+				if (_thread.joinable())
+				{
+					_thread.join();
+				}
+			}
+
+			// zero when nothing was armed, which disarm() ignores
+			unsigned long long arm(const Info* ti, const std::chrono::milliseconds limit, const bool abort_on_expiry)
+			{
+				if (!_watching)
+				{
+					return 0;
+				}
+				const auto now = std::chrono::steady_clock::now();
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (!_thread.joinable())
+				{
+					_thread = std::thread([this]() { watch(); });
+				}
+				const unsigned long long id = ++_next_id;
+				_armed.push_back(Entry{ id, ti, now, now + limit, limit, abort_on_expiry, false });
+				_cv.notify_one();
+				return id;
+			}
+
+			// In an isolated worker the parent owns the deadline and names the test itself. Called in
+			// the worker right after the fork, while it has a single thread. The fork copied the
+			// parent's mutex, which its watchdog thread may have held, its condition variable, which
+			// that thread may be waiting on, and its thread handle, but not the thread. They are
+			// replaced without being destroyed, so a test that calls exit() doesn't hang the worker
+			// in the destructor waiting for a thread that isn't there.
+			void stop_watching()
+			{
+				_watching = false;
+				::new (&_mutex) std::mutex();
+				::new (&_cv) std::condition_variable();
+				::new (&_thread) std::thread();
+			}
+
+			void disarm(const unsigned long long id)
+			{
+				if (id == 0)
+				{
+					return;
+				}
+				std::lock_guard<std::mutex> lock(_mutex);
+				for (auto itr = _armed.begin(); itr != _armed.end(); ++itr)
+				{
+					if (itr->id == id)
+					{
+						_armed.erase(itr);
+						break;
+					}
+				}
+			}
+
+		private:
+			struct Entry
+			{
+				unsigned long long id;
+				const Info* info;
+				std::chrono::steady_clock::time_point started;
+				std::chrono::steady_clock::time_point deadline;
+				std::chrono::milliseconds limit;
+				bool abort_on_expiry;
+				bool reported;
+			};
+
+			Watchdog()
+				: _mutex()
+				, _cv()
+				, _armed()
+				, _thread()
+				, _next_id(0)
+				, _stopping(false)
+				, _watching(true)
+			{}
+
+			void watch()
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				while (!_stopping)
+				{
+					auto next = std::chrono::steady_clock::time_point::max();
+					const auto now = std::chrono::steady_clock::now();
+					for (auto& e : _armed)
+					{
+						if (e.reported)
+						{
+							continue;
+						}
+						if (e.deadline > now)
+						{
+							next = std::min(next, e.deadline);
+							continue;
+						}
+						e.reported = true;
+						const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - e.started);
+						std::fprintf(stderr, "%s(%d): test '%s' has been running for %lld ms, over its %lld ms time limit\n",
+							e.info->file, e.info->line, e.info->name, static_cast<long long>(elapsed.count()),
+							static_cast<long long>(e.limit.count()));
+						if (e.abort_on_expiry)
+						{
+							std::fflush(stderr);
+							std::abort();
+						}
+					}
+					if (next == std::chrono::steady_clock::time_point::max())
+					{
+						_cv.wait(lock);
+					}
+					else
+					{
+						_cv.wait_until(lock, next);
+					}
+				}
+			}
+
+			std::mutex _mutex;
+			std::condition_variable _cv;
+			std::vector<Entry> _armed;
+			std::thread _thread;
+			unsigned long long _next_id;
+			bool _stopping;
+			std::atomic<bool> _watching;
+		};
+	}
+
+	Status Runner::run(const Info* const ti, Result& out_res, const Run_Options& options)
+	{
+		{
+#if UTEST_CPP_TRACK_ALLOCATIONS
+			// closed after the fixture is destroyed, so what the test keeps in its fixture isn't a leak
+			detail::Allocation_Scope allocations(out_res.allocations);
+#endif
+			detail::Test_Instance tst(ti);
+			execute_case(*tst, ti, out_res, options);
+		}
+		return conclude(out_res, options);
+	}
+
+	void Runner::execute_case(Test& tst, const Info* const ti, Result& res, const Run_Options& options)
+	{
+		res.info = ti;
+		tst.select_case(res.case_index);
+		const auto limit = time_limit(ti, options);
+		if (limit.count() <= 0)
+		{
+			tst.execute(res);
+			return;
+		}
+
+		struct Armed
+		{
+			~Armed() { detail::Watchdog::get().disarm(id); }
+			unsigned long long id;
+		} armed{ detail::Watchdog::get().arm(ti, limit, options.abort_on_timeout) };
+		tst.execute(res);
+	}
+
+	void Runner::mark_timeout(Result& res, const std::chrono::milliseconds limit)
+	{
+		std::ostringstream msg;
+		msg << "timed out after " << std::chrono::duration_cast<std::chrono::milliseconds>(res.duration).count()
+			<< " ms (limit " << limit.count() << " ms)";
+		const Failure failure = Failure::message(msg.str(), res.info ? res.info->file : "", res.info ? res.info->line : 0);
+		if (res.failures.empty())
+		{
+			res.failure = failure;
+		}
+		res.failures.push_back(failure);
+		res.status = Status::timeout;
+	}
+
+	namespace detail
+	{
+		// Pins the calling thread to one core for its lifetime, then puts the old affinity back.
+		// Only Linux is supported; elsewhere nothing is pinned.
+		class Affinity_Scope final
+		{
+		public:
+			explicit Affinity_Scope(const int cpu)
+				: _pinned(false)
+			{
+#if defined(__linux__)
+				if (cpu < 0 || cpu >= CPU_SETSIZE || ::sched_getaffinity(0, sizeof(_previous), &_previous) != 0)
+				{
+					return;
+				}
+				cpu_set_t wanted;
+				CPU_ZERO(&wanted);
+				CPU_SET(cpu, &wanted);
+				_pinned = ::sched_setaffinity(0, sizeof(wanted), &wanted) == 0;
+#else
+				(void)cpu;
+#endif
+			}
+
+			~Affinity_Scope()
+			{
+#if defined(__linux__)
+				if (_pinned)
+				{
+					::sched_setaffinity(0, sizeof(_previous), &_previous);
+				}
+#endif
+			}
+
+			Affinity_Scope(const Affinity_Scope&) = delete;
+			Affinity_Scope& operator=(const Affinity_Scope&) = delete;
+
+			bool pinned() const { return _pinned; }
+
+		private:
+			bool _pinned;
+#if defined(__linux__)
+			cpu_set_t _previous;
+#endif
+		};
+	}
+
+	Repeat_Stats Runner::repeat_test(const Info* const ti, const Repeat_Options& repeat, const Observer_Func& observer,
+		const Run_Options& options)
+	{
+		Repeat_Stats stats;
+		const detail::Affinity_Scope affinity(repeat.cpu);
+		stats.pinned = affinity.pinned();
+
+		std::vector<unsigned char> evict(repeat.evict_bytes);
+		std::unique_ptr<detail::Test_Instance> warm;
+#if UTEST_CPP_TRACK_ALLOCATIONS
+		// warm runs share the instance, so like the cases in run_on_instance() they are concluded once
+		// it has been destroyed
+		Allocation_Stats shared;
+		std::unique_ptr<detail::Allocation_Scope> warm_allocations;
+		std::vector<std::unique_ptr<Result>> held;
+#endif
+		std::vector<double> durations;
+		const bool timed = repeat.duration.count() > 0;
+		const unsigned long long count = repeat.count ? repeat.count : timed ? ~0ull : 1;
+		const auto deadline = std::chrono::steady_clock::now() + repeat.duration;
+		unsigned long long failed = 0;
+
+		// a run that has been concluded
+		auto account = [&](Result& res)
+		{
+			++stats.runs;
+			durations.push_back(static_cast<double>(res.duration.count()));
+			const auto ns = static_cast<unsigned long long>(res.duration.count() > 0 ? res.duration.count() : 1);
+			size_t bucket = 0;
+			while ((ns >> (bucket + 1)) != 0)
+			{
+				++bucket;
+			}
+			if (stats.histogram.size() <= bucket)
+			{
+				stats.histogram.resize(bucket + 1, 0);
+			}
+			++stats.histogram[bucket];
+			if (res.status == Status::pass)
+			{
+				++stats.passed;
+			}
+			else if (failed++ == 0)
+			{
+				stats.first_failure = res;
+			}
+			if (observer)
+			{
+				observer(res);
+			}
+		};
+
+		for (unsigned long long n = 0; n < count; ++n)
+		{
+			if (timed && n > 0 && std::chrono::steady_clock::now() >= deadline)
+			{
+				break;
+			}
+			// a cache line at a time is enough to replace what the last run left behind
+			for (size_t i = 0; i < evict.size(); i += 64)
+			{
+				evict[i] = static_cast<unsigned char>(evict[i] + 1);
+			}
+			clobber_memory();
+
+			std::unique_ptr<Result> owned(new Result());
+			Result& res = *owned;
+			res.case_index = repeat.case_index;
+#if !UTEST_CPP_NO_EXCEPTIONS
+			try
+#endif
+			{
+				if (repeat.reuse_instance)
+				{
+					if (!warm)
+					{
+#if UTEST_CPP_TRACK_ALLOCATIONS
+						if (!warm_allocations)
+						{
+							warm_allocations.reset(new detail::Allocation_Scope(shared, true));
+						}
+#endif
+						warm.reset(new detail::Test_Instance(ti));
+					}
+					execute_case(**warm, ti, res, options);
+#if !UTEST_CPP_TRACK_ALLOCATIONS
+					conclude(res, options);
+#endif
+				}
+				else
+				{
+					run(ti, res, options);
+				}
+			}
+#if !UTEST_CPP_NO_EXCEPTIONS
+			catch (const std::exception& ex)
+			{
+				// the fixture constructor threw, and the run still counts
+				res.info = ti;
+				res.started = std::chrono::steady_clock::now();
+				res.exception(ex);
+			}
+#endif
+
+#if UTEST_CPP_TRACK_ALLOCATIONS
+			if (repeat.reuse_instance)
+			{
+				// whether it leaked isn't known until the instance is gone, but whether it failed is
+				failed += res.status != Status::pass;
+				held.push_back(std::move(owned));
+			}
+			else
+#endif
+			{
+				account(res);
+			}
+			if (options.max_failures && failed >= options.max_failures)
+			{
+				break;
+			}
+		}
+		warm.reset();
+#if UTEST_CPP_TRACK_ALLOCATIONS
+		warm_allocations.reset();
+		failed = 0;
+		for (auto& res : held)
+		{
+			conclude(*res, options);
+			account(*res);
+		}
+#endif
+		if (ti->suite)
+		{
+			detail::Suite_Cache::get().release(ti->suite);
+		}
+
+		if (durations.empty())
+		{
+			return stats;
+		}
+		std::sort(durations.begin(), durations.end());
+		const size_t n = durations.size();
+		double sum = 0;
+		for (const auto d : durations)
+		{
+			sum += d;
+		}
+		const double mean = sum / n;
+		double squares = 0;
+		for (const auto d : durations)
+		{
+			squares += (d - mean) * (d - mean);
+		}
+		auto percentile = [&durations, n](const double p) { return durations[static_cast<size_t>(std::ceil(p * n)) - 1]; };
+		stats.min = durations.front();
+		stats.median = n % 2 ? durations[n / 2] : (durations[n / 2 - 1] + durations[n / 2]) / 2;
+		stats.p90 = percentile(0.90);
+		stats.p99 = percentile(0.99);
+		stats.max = durations.back();
+		stats.mean = mean;
+		stats.stddev = n > 1 ? std::sqrt(squares / (n - 1)) : 0;
+		return stats;
+	}
+
+	void Runner::mark_leak(Result& res)
+	{
+		std::ostringstream msg;
+		msg << "leaked " << res.allocations.leaked_bytes << " bytes in " << res.allocations.leaked_count << " allocations";
+		res.fail(msg.str(), res.info ? res.info->file : "", res.info ? res.info->line : 0);
+	}
+
+	Status Runner::dispatch_parallel(const std::vector<const Info*>& tests, const Observer_Func& observer,
+		const Run_Options& options)
+	{
+		const detail::Schedule schedule(tests, detail::history_estimate(options), options.failures_first,
+			detail::requested_worker_count(options), options.case_batch, options.suite_batch);
+		const auto& scheduled = schedule.tests();
+		const auto& tasks = schedule.tasks();
+		const unsigned worker_count = detail::resolve_worker_count(options, tasks.size());
+		std::atomic<size_t> failed(0);
+
+		// once max_failures is reached workers finish their current test and start no more
+		auto cancelled = [&failed, &options]()
+		{
+			return options.max_failures && failed.load(std::memory_order_relaxed) >= options.max_failures;
+		};
+
+		auto tally = [&failed](const Result& res)
+		{
+			if (res.status != Status::pass)
+			{
+				failed.fetch_add(1, std::memory_order_relaxed);
+			}
+		};
+
+		// runs a test, or cases [case_begin, case_end) of a TEST_P on a single instance
+		auto execute = [&](const unsigned worker, const Info* ti, size_t case_begin, size_t case_end, const auto& deliver)
+		{
+			if (!ti->parameterized())
+			{
+				case_begin = 0;
+				case_end = 1;
+			}
+			else if (case_end == 0)
+			{
+				case_end = ti->case_count();
+			}
+			size_t next = case_begin;
+#if !UTEST_CPP_NO_EXCEPTIONS
+			try
+#endif
+			{
+				run_on_instance(ti, case_begin, case_end, worker, options, cancelled, [&](Result& res)
+				{
+					next = res.case_index + 1;
+					tally(res);
+					deliver(res);
+				});
+			}
+#if !UTEST_CPP_NO_EXCEPTIONS
+			catch (const std::exception& ex)
+			{
+				// the fixture constructor threw; there is no caller on this thread to propagate to
+				for (; next < case_end; ++next)
+				{
+					Result res;
+					res.info = ti;
+					res.case_index = next;
+					res.worker = worker;
+					res.started = std::chrono::steady_clock::now();
+					res.exception(ex);
+					tally(res);
+					deliver(res);
+				}
+			}
+#endif
+		};
+
+		if (worker_count > 0)
+		{
+			std::vector<detail::Work_Queue> queues(worker_count);
+			const auto& costs = schedule.costs();
+			if (costs.empty())
+			{
+				for (size_t i = 0; i < tasks.size(); ++i)
+				{
+					queues[i % worker_count].push(tasks[i]);
+				}
+			}
+			else
+			{
+				// longest first onto the least loaded queue; stealing evens out what the estimate missed
+				std::vector<long long> load(worker_count, 0);
+				for (size_t i = 0; i < tasks.size(); ++i)
+				{
+					const size_t lightest = static_cast<size_t>(std::min_element(load.begin(), load.end()) - load.begin());
+					queues[lightest].push(tasks[i]);
+					load[lightest] += costs[i];
+				}
+			}
+
+			// tests not yet started per suite; a worker drops its copy of a context once this reaches zero
+			const auto& suites = schedule.suites();
+			std::unique_ptr<std::atomic<size_t>[]> pending(new std::atomic<size_t>[suites.size()]);
+			for (size_t i = 0; i < suites.size(); ++i)
+			{
+				pending[i].store(0, std::memory_order_relaxed);
+			}
+			for (const auto& task : tasks)
+			{
+				for (size_t i = task.begin; i < task.end; ++i)
+				{
+					if (schedule.suite_slot(i) != detail::Schedule::no_suite)
+					{
+						pending[schedule.suite_slot(i)].fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+			}
+			auto finished_suite = [&](const Suite_Info* suite)
+			{
+				const auto itr = std::find(suites.begin(), suites.end(), suite);
+				return itr != suites.end() && pending[static_cast<size_t>(itr - suites.begin())].load() == 0;
+			};
+
+			detail::Result_Channel channel(observer, options.observer_delivery, worker_count);
+			auto deliver = [&channel](Result& res) { channel.deliver(res); };
+
+			auto worker = [&](const unsigned index)
+			{
+				detail::Task task;
+				while (!cancelled())
+				{
+					bool found = queues[index].pop(task);
+					for (unsigned i = 1; !found && i < worker_count; ++i)
+					{
+						found = queues[(index + i) % worker_count].steal(task);
+					}
+					if (!found)
+					{
+						break;
+					}
+
+					for (size_t i = task.begin; i != task.end && !cancelled(); ++i)
+					{
+						const size_t slot = schedule.suite_slot(i);
+						if (slot != detail::Schedule::no_suite)
+						{
+							pending[slot].fetch_sub(1);
+						}
+						execute(index + 1, scheduled[i], task.case_begin, task.case_end, deliver);
+						detail::Suite_Cache::get().release_if(finished_suite);
+					}
+				}
+				detail::Suite_Cache::get().release_all();
+				channel.finished();
+			};
+
+			detail::Thread_Group workers;
+			for (unsigned i = 0; i < worker_count; ++i)
+			{
+				workers.spawn([&worker, i]() { worker(i); });
+			}
+			channel.drain();
+			workers.join();
+		}
+
+		// the pool has drained, so serial tests have the process to themselves
+		const auto& serial = schedule.serial();
+		for (size_t i = 0; i < serial.size() && !cancelled(); ++i)
+		{
+			execute(0, serial[i], 0, 0, observer);
+			if (serial[i]->suite && (cancelled() || i + 1 == serial.size() || serial[i + 1]->suite != serial[i]->suite))
+			{
+				detail::Suite_Cache::get().release(serial[i]->suite);
+			}
+		}
+
+		// every test that started was tallied; any that didn't were cancelled after a failure
+		return failed == 0 ? Status::pass : Status::fail;
+	}
+
+#if UTEST_CPP_COROUTINES
+	namespace detail
+	{
+		Event_Loop::Event_Loop()
+			: _mutex()
+			, _cv()
+			, _ready()
+			, _running()
+			, _timers()
+			, _order(0)
+		{}
+
+		void Event_Loop::post(const std::coroutine_handle<> handle, Result* const context)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_ready.push_back(Item{ handle, context });
+			}
+			_cv.notify_one();
+		}
+
+		void Event_Loop::post_at(const std::chrono::steady_clock::time_point when, const std::coroutine_handle<> handle,
+			Result* const context)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_timers.push_back(Timer{ when, _order++, Item{ handle, context } });
+				std::push_heap(_timers.begin(), _timers.end(), &Event_Loop::later);
+			}
+			_cv.notify_one();
+		}
+
+		bool Event_Loop::later(const Timer& a, const Timer& b)
+		{
+			return a.when != b.when ? a.when > b.when : a.order > b.order;
+		}
+
+		void Event_Loop::run_once()
+		{
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				for (;;)
+				{
+					const auto now = std::chrono::steady_clock::now();
+					while (!_timers.empty() && _timers.front().when <= now)
+					{
+						std::pop_heap(_timers.begin(), _timers.end(), &Event_Loop::later);
+						_ready.push_back(_timers.back().item);
+						_timers.pop_back();
+					}
+					if (!_ready.empty())
+					{
+						break;
+					}
+					if (_timers.empty())
+					{
+						_cv.wait(lock);
+					}
+					else
+					{
+						_cv.wait_until(lock, _timers.front().when);
+					}
+				}
+				_running.swap(_ready);
+			}
+			auto& current = current_result();
+			Result* const previous = current;
+			for (const auto& item : _running)
+			{
+				current = item.context;
+				item.handle.resume();
+			}
+			current = previous;
+			_running.clear();
+		}
+
+		// makes a loop the current one of this thread for the lifetime of the scope
+		class Event_Loop_Scope final
+		{
+		public:
+			explicit Event_Loop_Scope(Event_Loop& loop)
+				: _previous(current_event_loop())
+			{
+				current_event_loop() = &loop;
+			}
+
+			~Event_Loop_Scope()
+			{
+				current_event_loop() = _previous;
+			}
+
+			Event_Loop_Scope(const Event_Loop_Scope&) = delete;
+			Event_Loop_Scope& operator=(const Event_Loop_Scope&) = delete;
+
+		private:
+			Event_Loop* _previous;
+		};
+
+		// the time since phase_start, which moves on to now
+		inline std::chrono::nanoseconds lap(std::chrono::steady_clock::time_point& phase_start)
+		{
+			const auto now = std::chrono::steady_clock::now();
+			const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - phase_start);
+			phase_start = now;
+			return elapsed;
+		}
+
+		// A coroutine nobody awaits. It waits for the loop to resume it first, and frees itself once done.
+		struct Detached
+		{
+			struct promise_type
+			{
+				Detached get_return_object() { return Detached{ std::coroutine_handle<promise_type>::from_promise(*this) }; }
+				std::suspend_always initial_suspend() noexcept { return {}; }
+				std::suspend_never final_suspend() noexcept { return {}; }
+				void return_void() {}
+				void unhandled_exception() { std::terminate(); }
+			};
+
+			std::coroutine_handle<promise_type> handle;
+		};
+
+		Detached await_on_loop(Async task, bool& done, std::exception_ptr& error)
+		{
+			try
+			{
+				co_await task;
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+			done = true;
+		}
+
+		// One coroutine test from construction to its concluded result, which goes to finish().
+		Detached run_async_test(const Info* const ti, const unsigned worker, const Run_Options& options,
+			const std::function<void(Result&)>& finish)
+		{
+			Result res;
+			res.info = ti;
+			res.worker = worker;
+			// the loop puts back whatever was current when this suspends, and restores res when it resumes
+			current_result() = &res;
+			std::unique_ptr<Test> tst;
+			try
+			{
+				tst = ti->f();
+			}
+			catch (const std::exception& ex)
+			{
+				res.started = std::chrono::steady_clock::now();
+				res.exception(ex);
+			}
+			if (tst)
+			{
+				const auto limit = Runner::time_limit(ti, options);
+				const unsigned long long armed = limit.count() > 0 ? Watchdog::get().arm(ti, limit, options.abort_on_timeout) : 0;
+				co_await static_cast<Async_Test&>(*tst).execute_async(res);
+				if (armed)
+				{
+					Watchdog::get().disarm(armed);
+				}
+				tst.reset();
+			}
+			Runner::conclude(res, options);
+			finish(res);
+		}
+	}
+
+	Async Async_Test::execute_async(Result& res)
+	{
+		const auto test_start_time = std::chrono::steady_clock::now();
+		auto phase_start_time = test_start_time;
+		res.started = test_start_time;
+
+		// the body's time includes the time it spent suspended
+		auto* phase = &res.setup_duration;
+		try
+		{
+			pre_test();
+			*phase = detail::lap(phase_start_time);
+			phase = &res.test_duration;
+			co_await execute_async_test();
+			if (res.failures.empty())
+			{
+				res.status = Status::pass;
+			}
+		}
+		catch (const assert_fail_exception& ex)
+		{
+			res.fail(ex.failure());
+		}
+		catch (const std::exception& ex)
+		{
+			res.exception(ex);
+		}
+		*phase = detail::lap(phase_start_time);
+		post_test();
+		res.teardown_duration = detail::lap(phase_start_time);
+		res.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(phase_start_time - test_start_time);
+		report(res);
+	}
+
+	// outside run_async() the body runs on a loop of its own, blocking the thread until it finishes
+	void Async_Test::execute_test()
+	{
+		detail::Event_Loop loop;
+		const detail::Event_Loop_Scope scope(loop);
+		bool done = false;
+		std::exception_ptr error;
+		loop.post(detail::await_on_loop(execute_async_test(), done, error).handle, detail::current_result());
+		while (!done)
+		{
+			loop.run_once();
+		}
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+	Status Runner::dispatch_async(const std::vector<const Info*>& tests, const Observer_Func& observer,
+		const Run_Options& options)
+	{
+		// serial and exclusive tests keep their guarantees by running in the usual way
+		std::vector<const Info*> async, rest;
+		for (const auto* ti : tests)
+		{
+			const bool multiplexed = ti->coroutine && !ti->parameterized()
+				&& ti->options.concurrency == Concurrency::parallel;
+			(multiplexed ? async : rest).push_back(ti);
+		}
+
+		std::atomic<size_t> failed(0);
+		auto cancelled = [&failed, &options]()
+		{
+			return options.max_failures && failed.load(std::memory_order_relaxed) >= options.max_failures;
+		};
+
+		const unsigned worker_count = detail::resolve_worker_count(options, async.size());
+		if (worker_count > 0)
+		{
+			std::atomic<size_t> next(0);
+			detail::Result_Channel channel(observer, options.observer_delivery, worker_count);
+
+			auto worker = [&](const unsigned index)
+			{
+				detail::Event_Loop loop;
+				const detail::Event_Loop_Scope scope(loop);
+				size_t in_flight = 0;
+				const std::function<void(Result&)> finish = [&](Result& res)
+				{
+					--in_flight;
+					if (res.status != Status::pass)
+					{
+						failed.fetch_add(1, std::memory_order_relaxed);
+					}
+					channel.deliver(res);
+				};
+
+				bool exhausted = false;
+				for (;;)
+				{
+					while (!exhausted && !cancelled() && (options.async_concurrency == 0 || in_flight < options.async_concurrency))
+					{
+						const size_t i = next.fetch_add(1);
+						if (i >= async.size())
+						{
+							exhausted = true;
+							break;
+						}
+						++in_flight;
+						loop.post(detail::run_async_test(async[i], index + 1, options, finish).handle, nullptr);
+					}
+					if (in_flight == 0)
+					{
+						break;
+					}
+					loop.run_once();
+				}
+				detail::Suite_Cache::get().release_all();
+				channel.finished();
+			};
+
+			detail::Thread_Group workers;
+			for (unsigned i = 0; i < worker_count; ++i)
+			{
+				workers.spawn([&worker, i]() { worker(i); });
+			}
+			channel.drain();
+			workers.join();
+		}
+
+		if (cancelled())
+		{
+			return Status::fail;
+		}
+		Run_Options rest_options(options);
+		if (rest_options.max_failures)
+		{
+			rest_options.max_failures -= static_cast<unsigned>(failed.load());
+		}
+		const Status status = rest.empty() ? Status::pass : dispatch_parallel(rest, observer, rest_options);
+		return failed == 0 ? status : Status::fail;
+	}
+#endif
+
+#if UTEST_CPP_PROCESS_ISOLATION
+	namespace detail
+	{
+		inline bool read_exact(const int fd, void* buffer, size_t size)
+		{
+			auto* out = static_cast<char*>(buffer);
+			while (size > 0)
+			{
+				const auto n = ::read(fd, out, size);
+				if (n < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				if (n <= 0)
+				{
+					return false;
+				}
+				out += n;
+				size -= static_cast<size_t>(n);
+			}
+			return true;
+		}
+
+		// Failures refer to their file by pointer; names arriving from another process are kept
+		// here for the lifetime of the program so those pointers stay valid.
+		inline const char* intern(const std::string& str)
+		{
+			static std::mutex mutex;
+			static std::set<std::string> strings;
+			if (str.empty())
+			{
+				return "";
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			return strings.insert(str).first->c_str();
+		}
+
+		inline bool write_exact(const int fd, const void* buffer, size_t size)
+		{
+			const auto* in = static_cast<const char*>(buffer);
+			while (size > 0)
+			{
+				const auto n = ::write(fd, in, size);
+				if (n < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				if (n <= 0)
+				{
+					return false;
+				}
+				in += n;
+				size -= static_cast<size_t>(n);
+			}
+			return true;
+		}
+
+		// Result records travel as a fixed header followed by each of the failures.
+		struct Result_Record_Header
+		{
+			std::uint32_t index;
+			std::int32_t status;
+			std::int64_t duration;
+			std::int64_t setup_duration;
+			std::int64_t test_duration;
+			std::int64_t teardown_duration;
+			std::int64_t started;		// steady clock, which forked workers share with the parent
+			Benchmark_Stats benchmark;
+			Allocation_Stats allocations;
+			Counter_Stats counters;
+			std::uint32_t failure_count;
+		};
+
+		// followed by the message and file name bytes
+		struct Failure_Record_Header
+		{
+			std::int32_t line;
+			std::uint32_t message_size;
+			std::uint32_t file_size;
+		};
+
+		inline bool write_result(const int fd, const std::uint32_t index, const Result& res)
+		{
+			Result_Record_Header header;
+			header.index = index;
+			header.status = static_cast<std::int32_t>(res.status);
+			header.duration = static_cast<std::int64_t>(res.duration.count());
+			header.setup_duration = static_cast<std::int64_t>(res.setup_duration.count());
+			header.test_duration = static_cast<std::int64_t>(res.test_duration.count());
+			header.teardown_duration = static_cast<std::int64_t>(res.teardown_duration.count());
+			header.started = static_cast<std::int64_t>(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(res.started.time_since_epoch()).count());
+			header.benchmark = res.benchmark;
+			header.allocations = res.allocations;
+			header.counters = res.counters;
+			header.failure_count = static_cast<std::uint32_t>(res.failures.size());
+
+			std::string record(reinterpret_cast<const char*>(&header), sizeof(header));
+			for (const auto& f : res.failures)
+			{
+				const std::string message = f.str();
+				Failure_Record_Header fh;
+				fh.line = f.line();
+				fh.message_size = static_cast<std::uint32_t>(message.size());
+				fh.file_size = static_cast<std::uint32_t>(std::strlen(f.file()));
+				record.append(reinterpret_cast<const char*>(&fh), sizeof(fh));
+				record.append(message);
+				record.append(f.file(), fh.file_size);
+			}
+			return write_exact(fd, record.data(), record.size());
+		}
+
+		inline bool read_result(const int fd, std::uint32_t& out_index, Result& out_res)
+		{
+			Result_Record_Header header;
+			if (!read_exact(fd, &header, sizeof(header)))
+			{
+				return false;
+			}
+			out_index = header.index;
+			out_res.status = static_cast<Status>(header.status);
+			out_res.duration = std::chrono::nanoseconds(header.duration);
+			out_res.setup_duration = std::chrono::nanoseconds(header.setup_duration);
+			out_res.test_duration = std::chrono::nanoseconds(header.test_duration);
+			out_res.teardown_duration = std::chrono::nanoseconds(header.teardown_duration);
+			out_res.started = std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::nanoseconds(header.started)));
+			out_res.benchmark = header.benchmark;
+			out_res.allocations = header.allocations;
+			out_res.counters = header.counters;
+			for (std::uint32_t i = 0; i < header.failure_count; ++i)
+			{
+				Failure_Record_Header fh;
+				if (!read_exact(fd, &fh, sizeof(fh)))
+				{
+					return false;
+				}
+				std::string message(fh.message_size, '\0');
+				std::string file(fh.file_size, '\0');
+				if ((fh.message_size && !read_exact(fd, &message[0], fh.message_size))
+					|| (fh.file_size && !read_exact(fd, &file[0], fh.file_size)))
+				{
+					return false;
+				}
+				out_res.failures.push_back(Failure::message(std::move(message), intern(file), fh.line));
+			}
+			if (!out_res.failures.empty())
+			{
+				out_res.failure = out_res.failures.front();
+			}
+			return true;
+		}
+
+		inline std::string describe_exit(const int wait_status)
+		{
+			std::ostringstream msg;
+			if (WIFSIGNALED(wait_status))
+			{
+				const int sig = WTERMSIG(wait_status);
+				msg << "worker process terminated by signal " << sig;
+				if (const char* name = ::strsignal(sig))
+				{
+					msg << " (" << name << ")";
+				}
+			}
+			else if (WIFEXITED(wait_status))
+			{
+				msg << "worker process exited with code " << WEXITSTATUS(wait_status);
+			}
+			else
+			{
+				msg << "worker process stopped unexpectedly";
+			}
+			return msg.str();
+		}
+
+		// Owns the forked workers. Tests (and TEST_P cases) are handed out one at a time over each
+		// worker's command pipe so the parent always knows which test a dead worker was executing.
+		class Process_Pool
+		{
+		public:
+			template<class Run_Func>
+			Process_Pool(const unsigned worker_count, const Run_Func& run_test)
+				: _workers(worker_count)
+				, _run_test(run_test)
+			{
+				struct sigaction ignore;
+				std::memset(&ignore, 0, sizeof(ignore));
+				ignore.sa_handler = SIG_IGN;
+				::sigaction(SIGPIPE, &ignore, &_old_sigpipe);
+			}
+
+			~Process_Pool()
+			{
+				for (auto& w : _workers)
+				{
+					stop(w);
+				}
+				::sigaction(SIGPIPE, &_old_sigpipe, nullptr);
+			}
+
+			size_t size() const { return _workers.size(); }
+
+			bool send(const size_t worker, const std::uint32_t index, const std::uint32_t case_index)
+			{
+				auto& w = _workers[worker];
+				const Command command = { index, case_index };
+				for (int attempt = 0; attempt < 2; ++attempt)
+				{
+					if (w.pid <= 0 && !spawn(w))
+					{
+						return false;
+					}
+					w.started = std::chrono::steady_clock::now();
+					if (write_exact(w.cmd_fd, &command, sizeof(command)))
+					{
+						return true;
+					}
+					// the idle worker died between tests; replace it and try once more
+					stop(w);
+				}
+				return false;
+			}
+
+			int result_fd(const size_t worker) const { return _workers[worker].res_fd; }
+
+			std::chrono::steady_clock::time_point started(const size_t worker) const { return _workers[worker].started; }
+
+			// kills a worker stuck in a test; the next send() starts a replacement
+			std::chrono::nanoseconds kill(const size_t worker)
+			{
+				auto& w = _workers[worker];
+				const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now() - w.started);
+				if (w.pid > 0)
+				{
+					::kill(w.pid, SIGKILL);
+				}
+				stop(w);
+				return elapsed;
+			}
+
+			// Reads the finished result, or reaps the worker and describes why it died.
+			bool receive(const size_t worker, Result& out_res, std::string& out_crash)
+			{
+				auto& w = _workers[worker];
+				std::uint32_t index = 0;
+				if (read_result(w.res_fd, index, out_res))
+				{
+					return true;
+				}
+				out_res.started = w.started;
+				out_res.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now() - w.started);
+				out_crash = describe_exit(stop(w));
+				return false;
+			}
+
+		private:
+			struct Command
+			{
+				std::uint32_t index;
+				std::uint32_t case_index;		// for a TEST_P
+			};
+
+			struct Worker
+			{
+				Worker()
+					: pid(-1)
+					, cmd_fd(-1)
+					, res_fd(-1)
+					, started()
+				{}
+
+				pid_t pid;
+				int cmd_fd;
+				int res_fd;
+				std::chrono::steady_clock::time_point started;
+			};
+
+			bool spawn(Worker& w)
+			{
+				int cmd[2], res[2];
+				if (::pipe(cmd) != 0)
+				{
+					return false;
+				}
+				if (::pipe(res) != 0)
+				{
+					::close(cmd[0]);
+					::close(cmd[1]);
+					return false;
+				}
+
+				// anything still buffered would otherwise be written by both processes
+				std::fflush(nullptr);
+				const pid_t pid = ::fork();
+				if (pid < 0)
+				{
+					::close(cmd[0]);
+					::close(cmd[1]);
+					::close(res[0]);
+					::close(res[1]);
+					return false;
+				}
+				if (pid == 0)
+				{
+					// other workers' pipes must be closed or their crashes would never reach EOF
+					for (auto& other : _workers)
+					{
+						if (other.cmd_fd >= 0) ::close(other.cmd_fd);
+						if (other.res_fd >= 0) ::close(other.res_fd);
+					}
+					::close(cmd[1]);
+					::close(res[0]);
+					serve(cmd[0], res[1]);
+				}
+
+				::close(cmd[0]);
+				::close(res[1]);
+				w.pid = pid;
+				w.cmd_fd = cmd[1];
+				w.res_fd = res[0];
+				return true;
+			}
+
+			[[noreturn]] void serve(const int cmd_fd, const int res_fd)
+			{
+				// suite contexts are built afresh in each worker and kept until it is told to stop
+				Suite_Cache::get().forget();
+				Watchdog::get().stop_watching();
+				Command command = { 0, 0 };
+				while (read_exact(cmd_fd, &command, sizeof(command)))
+				{
+					Result res;
+					res.case_index = command.case_index;
+					_run_test(command.index, res);
+					std::fflush(nullptr);
+					if (!write_result(res_fd, command.index, res))
+					{
+						break;
+					}
+				}
+				Suite_Cache::get().release_all();
+				// skip static destructors and atexit handlers, they belong to the parent
+				::_exit(0);
+			}
+
+			int stop(Worker& w)
+			{
+				int wait_status = 0;
+				if (w.pid <= 0)
+				{
+					return wait_status;
+				}
+				::close(w.cmd_fd);
+				::close(w.res_fd);
+				while (::waitpid(w.pid, &wait_status, 0) < 0 && errno == EINTR)
+				{
+				}
+				w = Worker();
+				return wait_status;
+			}
+
+			std::vector<Worker> _workers;
+			std::function<void(std::uint32_t, Result&)> _run_test;
+			struct sigaction _old_sigpipe;
+		};
+	}
+
+	Status Runner::dispatch_isolated(const std::vector<const Info*>& tests, const Observer_Func& observer,
+		const Run_Options& options)
+	{
+		const detail::Schedule schedule(tests, detail::history_estimate(options), options.failures_first,
+			detail::requested_worker_count(options), options.case_batch, options.suite_batch);
+
+		// serial tests are appended as single-test tasks that run while the rest of the pool is idle
+		std::vector<const Info*> all(schedule.tests());
+		std::vector<detail::Task> tasks(schedule.tasks());
+		const size_t first_serial = tasks.size();
+		for (const auto* ti : schedule.serial())
+		{
+			all.push_back(ti);
+			tasks.push_back(detail::Task{ all.size() - 1, all.size(), 0, 0 });
+		}
+
+		const unsigned worker_count = detail::resolve_worker_count(options, tasks.size());
+		if (worker_count == 0)
+		{
+			return Status::pass;
+		}
+
+		size_t failed(0);
+		bool cancelled = false;
+		detail::Process_Pool pool(worker_count, [&all](const std::uint32_t index, Result& res)
+		{
+#if UTEST_CPP_NO_EXCEPTIONS
+			run(all[index], res);
+#else
+			try
+			{
+				run(all[index], res);
+			}
+			catch (const std::exception& ex)
+			{
+				res.exception(ex);
+			}
+#endif
+		});
+
+		// the case cursor walks the cases of the TEST_P at the front of the task; other tests have one
+		struct Assignment
+		{
+			bool busy;
+			detail::Task task;
+			size_t case_index;
+			size_t case_end;
+		};
+		std::vector<Assignment> assigned(worker_count, Assignment{ false, detail::Task{ 0, 0, 0, 0 }, 0, 0 });
+		size_t next_task = 0;
+		size_t busy = 0;
+		std::vector<pollfd> fds;
+		std::vector<size_t> fd_workers;
+
+		auto first_case = [&all](Assignment& a)
+		{
+			const Info* ti = all[a.task.begin];
+			a.case_index = ti->parameterized() && a.task.case_end ? a.task.case_begin : 0;
+			a.case_end = !ti->parameterized() ? 1 : a.task.case_end ? a.task.case_end : ti->case_count();
+		};
+
+		// reports the result of the worker's current test or case and moves the cursor past it
+		auto report = [&](Assignment& a, Result& res)
+		{
+			res.worker = static_cast<unsigned>(&a - assigned.data()) + 1;
+			res.info = all[a.task.begin];
+			res.case_index = a.case_index++;
+			conclude(res, options);
+			if (res.status != Status::pass)
+			{
+				// once max_failures is reached tests already in flight still finish, but nothing new starts
+				++failed;
+				cancelled = cancelled || (options.max_failures && failed >= options.max_failures);
+			}
+			observer(res);
+		};
+
+		// moves a worker on to the next test or case of its task, failing any it cannot be given
+		auto advance = [&](const size_t worker)
+		{
+			auto& a = assigned[worker];
+			while (!cancelled && a.task.begin != a.task.end)
+			{
+				if (a.case_index >= a.case_end)
+				{
+					if (++a.task.begin != a.task.end)
+					{
+						first_case(a);
+					}
+					continue;
+				}
+				if (pool.send(worker, static_cast<std::uint32_t>(a.task.begin), static_cast<std::uint32_t>(a.case_index)))
+				{
+					return;
+				}
+				Result res;
+				res.started = std::chrono::steady_clock::now();
+				res.fail("unable to start worker process", "", 0);
+				report(a, res);
+			}
+			a.busy = false;
+			--busy;
+		};
+
+		for (;;)
+		{
+			for (size_t w = 0; w < worker_count && next_task < tasks.size() && !cancelled; ++w)
+			{
+				if (assigned[w].busy)
+				{
+					continue;
+				}
+				// serial tasks wait for an idle pool and then occupy it alone
+				if (next_task >= first_serial && busy > 0)
+				{
+					break;
+				}
+				assigned[w].busy = true;
+				assigned[w].task = tasks[next_task++];
+				first_case(assigned[w]);
+				++busy;
+				advance(w);
+				if (next_task > first_serial)
+				{
+					break;
+				}
+			}
+			if (busy == 0)
+			{
+				if (next_task < tasks.size() && !cancelled)
+				{
+					continue;
+				}
+				break;
+			}
+
+			// the poll wakes up for the nearest deadline, and a worker past its test's deadline is killed
+			fds.clear();
+			fd_workers.clear();
+			const auto now = std::chrono::steady_clock::now();
+			auto next_deadline = std::chrono::steady_clock::time_point::max();
+			for (size_t w = 0; w < worker_count; ++w)
+			{
+				if (!assigned[w].busy)
+				{
+					continue;
+				}
+				const auto limit = time_limit(all[assigned[w].task.begin], options);
+				if (limit.count() > 0 && now - pool.started(w) >= limit)
+				{
+					Result res;
+					res.started = pool.started(w);
+					res.duration = pool.kill(w);
+					res.info = all[assigned[w].task.begin];
+					mark_timeout(res, limit);
+					std::fprintf(stderr, "%s(%d): test '%s' was stopped after %lld ms, over its %lld ms time limit\n",
+						res.info->file, res.info->line, res.info->name,
+						static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(res.duration).count()),
+						static_cast<long long>(limit.count()));
+					report(assigned[w], res);
+					advance(w);
+					continue;
+				}
+				if (limit.count() > 0)
+				{
+					next_deadline = std::min(next_deadline, pool.started(w) + limit);
+				}
+				fds.push_back(pollfd{ pool.result_fd(w), POLLIN, 0 });
+				fd_workers.push_back(w);
+			}
+			if (fds.empty())
+			{
+				continue;
+			}
+			int wait_ms = -1;
+			if (next_deadline != std::chrono::steady_clock::time_point::max())
+			{
+				// rounded up, so the deadline has passed when poll returns
+				const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(next_deadline - now)
+					+ std::chrono::milliseconds(1);
+				wait_ms = static_cast<int>(std::max<long long>(0, static_cast<long long>(remaining.count())));
+			}
+			const int ready = ::poll(fds.data(), static_cast<nfds_t>(fds.size()), wait_ms);
+			if (ready < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				break;
+			}
+
+			for (size_t i = 0; i < fds.size(); ++i)
+			{
+				if (fds[i].revents == 0)
+				{
+					continue;
+				}
+				const size_t w = fd_workers[i];
+				auto& a = assigned[w];
+				Result res;
+				std::string crash;
+				if (!pool.receive(w, res, crash))
+				{
+					res.fail(crash, "", 0);
+				}
+				report(a, res);
+				advance(w);
+			}
+		}
+
+		return failed == 0 ? Status::pass : Status::fail;
+	}
+#else
+	Status Runner::dispatch_isolated(const std::vector<const Info*>& tests, const Observer_Func& observer,
+		const Run_Options& options)
+	{
+		return dispatch_parallel(tests, observer, options);
+	}
+#endif	// UTEST_CPP_PROCESS_ISOLATION
+
+	Registry& Registry::get()
+	{
+		static std::unique_ptr<Registry> instance;
+		if (!instance)
+		{
+			instance = std::make_unique<detail::Concrete_Registry>();
+		}
+		return *instance;
+	}
 
 	Registry::~Registry()
 	{		
 	}
 
+	void Benchmark::execute_test()
+	{
+		typedef std::chrono::steady_clock Clock;
+		const auto& opts = options();
+		auto time_batch = [this](const unsigned long long iterations)
+		{
+			const auto start = Clock::now();
+			execute_batch(iterations);
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+		};
+
+		// warm up with doubling batches; the last one gives the estimated cost of an iteration
+		unsigned long long iterations = 1;
+		auto batch_time = time_batch(iterations);
+		auto warmed = batch_time;
+		while (warmed < opts.warmup_time && iterations < opts.max_iterations)
+		{
+			iterations = std::min(iterations * 2, opts.max_iterations);
+			batch_time = time_batch(iterations);
+			warmed += batch_time;
+		}
+		const double per_iteration = static_cast<double>(batch_time.count()) / static_cast<double>(iterations);
+
+		const unsigned sample_count = opts.sample_count ? opts.sample_count : 1;
+		const double sample_target = static_cast<double>(opts.measure_time.count()) / sample_count;
+		double wanted = per_iteration > 0 ? sample_target / per_iteration : static_cast<double>(opts.max_iterations);
+		wanted = std::max(1.0, std::min(wanted, static_cast<double>(opts.max_iterations)));
+		iterations = static_cast<unsigned long long>(wanted);
+
+		std::vector<double> samples;
+		samples.reserve(sample_count);
+#if UTEST_CPP_PERF_COUNTERS
+		detail::Counter_Sample counters_before;
+		const bool counting = detail::sample_counters(counters_before);
+#endif
+		for (unsigned i = 0; i < sample_count; ++i)
+		{
+			samples.push_back(static_cast<double>(time_batch(iterations).count()) / static_cast<double>(iterations));
+		}
+#if UTEST_CPP_PERF_COUNTERS
+		detail::Counter_Sample counters_after;
+		if (counting && detail::sample_counters(counters_after))
+		{
+			_counters = detail::counter_delta(counters_before, counters_after,
+				static_cast<double>(iterations) * static_cast<double>(sample_count));
+		}
+#endif
+		std::sort(samples.begin(), samples.end());
+
+		const size_t n = samples.size();
+		double sum = 0;
+		for (const auto v : samples)
+		{
+			sum += v;
+		}
+		const double mean = sum / n;
+		double squares = 0;
+		for (const auto v : samples)
+		{
+			squares += (v - mean) * (v - mean);
+		}
+
+		_stats.iterations = iterations;
+		_stats.samples = static_cast<unsigned>(n);
+		_stats.min = samples.front();
+		_stats.median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+		_stats.mean = mean;
+		_stats.p99 = samples[static_cast<size_t>(std::ceil(0.99 * n)) - 1];
+		_stats.stddev = n > 1 ? std::sqrt(squares / (n - 1)) : 0;
+	}
+
+	bool Baseline::load(const std::string& path)
+	{
+		std::ifstream in(path);
+		if (!in)
+		{
+			return false;
+		}
+		std::vector<Entry> entries;
+		std::string line;
+		while (std::getline(in, line))
+		{
+			if (line.empty() || line[0] == '#')
+			{
+				continue;
+			}
+			std::istringstream fields(line);
+			Entry e = Entry();
+			if (!std::getline(fields, e.name, '\t') || !std::getline(fields, e.category, '\t'))
+			{
+				continue;
+			}
+			auto& st = e.stats;
+			if (!(fields >> st.samples >> st.iterations >> st.min >> st.median >> st.mean >> st.p99 >> st.stddev))
+			{
+				continue;
+			}
+			// older baselines end here; newer ones may add key=value fields
+			std::string field;
+			while (fields >> field)
+			{
+				const size_t eq = field.find('=');
+				if (eq == std::string::npos)
+				{
+					continue;
+				}
+				const std::string key = field.substr(0, eq);
+				std::string value = field.substr(eq + 1);
+				std::replace(value.begin(), value.end(), ',', ' ');
+				std::istringstream values(value);
+				if (key == "allocations")
+				{
+					auto& al = e.allocations;
+					al.tracked = static_cast<bool>(values >> al.count >> al.bytes >> al.peak_bytes);
+				}
+				else if (key == "instructions" && !(values >> e.instructions))
+				{
+					e.instructions = 0;
+				}
+			}
+			e.hash = Shard::hash(e.name.c_str(), e.category.c_str());
+			entries.push_back(std::move(e));
+		}
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.hash < b.hash; });
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_entries.swap(entries);
+		return true;
+	}
+
+	bool Failure_List::load(const std::string& path)
+	{
+		std::ifstream in(path);
+		if (!in)
+		{
+			return false;
+		}
+		std::vector<Entry> entries;
+		std::string line;
+		while (std::getline(in, line))
+		{
+			const auto tab = line.find('\t');
+			if (line.empty() || line[0] == '#' || tab == std::string::npos)
+			{
+				continue;
+			}
+			Entry e;
+			e.category = line.substr(0, tab);
+			e.name = line.substr(tab + 1);
+			e.hash = Shard::hash(e.name.c_str(), e.category.c_str());
+			entries.push_back(std::move(e));
+		}
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.hash < b.hash; });
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_entries.swap(entries);
+		return true;
+	}
+
+	bool Failure_List::save(const std::string& path) const
+	{
+		std::ofstream out(path);
+		if (!out)
+		{
+			return false;
+		}
+		out << "# utest failures: category, name\n";
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (const auto& e : _entries)
+		{
+			out << e.category << '\t' << e.name << '\n';
+		}
+		return static_cast<bool>(out);
+	}
+
+	void Failure_List::record(const Result& res)
+	{
+		if (!res.info || res.status == Status::not_run)
+		{
+			return;
+		}
+		const auto hash = Shard::hash(res.info);
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto itr = std::lower_bound(_entries.begin(), _entries.end(), hash,
+			[](const Entry& e, const unsigned long long h) { return e.hash < h; });
+		const bool listed = itr != _entries.end() && itr->hash == hash;
+		if (res.status == Status::pass)
+		{
+			if (listed)
+			{
+				_entries.erase(itr);
+			}
+		}
+		else if (!listed)
+		{
+			_entries.insert(itr, Entry{ hash, res.info->name, res.info->category });
+		}
+	}
+
+	bool Failure_List::contains(const Info* ti) const
+	{
+		const auto hash = Shard::hash(ti);
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto itr = std::lower_bound(_entries.begin(), _entries.end(), hash,
+			[](const Entry& e, const unsigned long long h) { return e.hash < h; });
+		return itr != _entries.end() && itr->hash == hash;
+	}
+
+	void Failure_List::prioritize(std::vector<const Info*>& tests) const
+	{
+		std::stable_partition(tests.begin(), tests.end(), [this](const Info* ti) { return contains(ti); });
+	}
+
+	size_t Failure_List::size() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _entries.size();
+	}
+
+	static const char duration_history_magic[8] = { 'U', 'T', 'D', 'U', 'R', '0', '0', '1' };
+
+	bool Duration_History::load(const std::string& path)
+	{
+		std::ifstream in(path, std::ios::binary);
+		char magic[sizeof(duration_history_magic)];
+		unsigned long long count = 0;
+		if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, duration_history_magic, sizeof(magic)) != 0
+			|| !in.read(reinterpret_cast<char*>(&count), sizeof(count)))
+		{
+			return false;
+		}
+		// the count has to describe exactly the records that follow, so a truncated or corrupt file is
+		// rejected before anything is allocated for it
+		const std::streamoff header = in.tellg();
+		if (header < 0 || !in.seekg(0, std::ios::end))
+		{
+			return false;
+		}
+		const std::streamoff end = in.tellg();
+		if (end < header || static_cast<unsigned long long>(end - header) / sizeof(Entry) != count
+			|| static_cast<unsigned long long>(end - header) % sizeof(Entry) != 0 || !in.seekg(header))
+		{
+			return false;
+		}
+		std::vector<Entry> entries;
+#if !UTEST_CPP_NO_EXCEPTIONS
+		try
+#endif
+		{
+			entries.resize(static_cast<size_t>(count));
+		}
+#if !UTEST_CPP_NO_EXCEPTIONS
+		catch (const std::exception&)
+		{
+			return false;
+		}
+#endif
+		if (count && !in.read(reinterpret_cast<char*>(entries.data()), static_cast<std::streamsize>(count * sizeof(Entry))))
+		{
+			return false;
+		}
+		// a hand-edited or foreign file might not be sorted; binary search relies on it
+		if (!std::is_sorted(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.hash < b.hash; }))
+		{
+			std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.hash < b.hash; });
+		}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_entries.swap(entries);
+		return true;
+	}
+
+	bool Duration_History::save(const std::string& path) const
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		std::lock_guard<std::mutex> lock(_mutex);
+		const unsigned long long count = _entries.size();
+		out.write(duration_history_magic, sizeof(duration_history_magic));
+		out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+		if (count)
+		{
+			out.write(reinterpret_cast<const char*>(_entries.data()), static_cast<std::streamsize>(count * sizeof(Entry)));
+		}
+		return static_cast<bool>(out);
+	}
+
+	void Duration_History::record(const Result& res)
+	{
+		if (!res.info || res.status == Status::not_run || res.duration.count() <= 0)
+		{
+			return;
+		}
+		const auto hash = Shard::hash(res.info);
+		const long long sample = static_cast<long long>(res.duration.count());
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto itr = std::lower_bound(_entries.begin(), _entries.end(), hash,
+			[](const Entry& e, const unsigned long long h) { return e.hash < h; });
+		if (itr == _entries.end() || itr->hash != hash)
+		{
+			_entries.insert(itr, Entry{ hash, sample });
+			return;
+		}
+		const double blended = static_cast<double>(itr->nanoseconds)
+			+ smoothing * static_cast<double>(sample - itr->nanoseconds);
+		itr->nanoseconds = std::max(1ll, static_cast<long long>(blended));
+	}
+
+	std::chrono::nanoseconds Duration_History::estimate(const Info* ti) const
+	{
+		const auto hash = Shard::hash(ti);
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto itr = std::lower_bound(_entries.begin(), _entries.end(), hash,
+			[](const Entry& e, const unsigned long long h) { return e.hash < h; });
+		if (itr == _entries.end() || itr->hash != hash)
+		{
+			return std::chrono::nanoseconds(0);
+		}
+		return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(itr->nanoseconds));
+	}
+
+	size_t Duration_History::size() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _entries.size();
+	}
+
+	namespace detail
+	{
+		// Inside an attribute, whitespace other than a space is written as a character reference;
+		// parsers normalize it to spaces otherwise.
+		void append_xml_escaped(std::string& out, const char* text, const bool attribute = false)
+		{
+			for (; text && *text; ++text)
+			{
+				switch (*text)
+				{
+				case '&': out += "&amp;"; break;
+				case '<': out += "&lt;"; break;
+				case '>': out += "&gt;"; break;
+				case '"': out += "&quot;"; break;
+				case '\'': out += "&apos;"; break;
+				case '\n': out += attribute ? "&#10;" : "\n"; break;
+				case '\r': out += attribute ? "&#13;" : "\r"; break;
+				case '\t': out += attribute ? "&#9;" : "\t"; break;
+				default:
+					// XML 1.0 cannot carry the other control characters, even escaped
+					if (static_cast<unsigned char>(*text) >= 0x20)
+					{
+						out += *text;
+					}
+					break;
+				}
+			}
+		}
+
+		void append_json_string(std::string& out, const char* text)
+		{
+			out += '"';
+			for (; text && *text; ++text)
+			{
+				const unsigned char c = static_cast<unsigned char>(*text);
+				switch (c)
+				{
+				case '"': out += "\\\""; break;
+				case '\\': out += "\\\\"; break;
+				case '\n': out += "\\n"; break;
+				case '\r': out += "\\r"; break;
+				case '\t': out += "\\t"; break;
+				default:
+					if (c < 0x20)
+					{
+						char code[8];
+						std::snprintf(code, sizeof(code), "\\u%04x", c);
+						out += code;
+					}
+					else
+					{
+						out += static_cast<char>(c);
+					}
+					break;
+				}
+			}
+			out += '"';
+		}
+
+		void append_number(std::string& out, const double value)
+		{
+			char text[32];
+			std::snprintf(text, sizeof(text), "%.17g", value);
+			out += text;
+		}
+
+		void append_seconds(std::string& out, const std::chrono::nanoseconds duration)
+		{
+			char text[32];
+			std::snprintf(text, sizeof(text), "%.9f", std::chrono::duration<double>(duration).count());
+			out += text;
+		}
+
+		// Cases of a parameterized test share a name, so they are told apart as "Name/3"
+		void append_case_suffix(std::string& out, const Result& res)
+		{
+			if (res.info && res.info->parameterized())
+			{
+				out += '/';
+				out += std::to_string(res.case_index);
+			}
+		}
+	}
+
+	Reporter::Reporter(std::ostream& os, const std::chrono::milliseconds flush_interval)
+		: _file()
+		, _os(&os)
+		, _buffer()
+		, _flush_interval(flush_interval)
+		, _last_flush(std::chrono::steady_clock::now())
+		, _started(false)
+		, _finished(false)
+		, _mutex()
+	{
+		_buffer.reserve(buffer_capacity);
+	}
+
+	Reporter::Reporter(const std::string& path, const std::chrono::milliseconds flush_interval)
+		: _file(new std::ofstream(path, std::ios::out | std::ios::trunc | std::ios::binary))
+		, _os(_file.get())
+		, _buffer()
+		, _flush_interval(flush_interval)
+		, _last_flush(std::chrono::steady_clock::now())
+		, _started(false)
+		, _finished(false)
+		, _mutex()
+	{
+		_buffer.reserve(buffer_capacity);
+	}
+
+	Reporter::~Reporter()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		flush();
+	}
+
+	void Reporter::operator()(const Result& res)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_finished)
+		{
+			return;
+		}
+		start();
+		write_result(_buffer, res);
+		if (_buffer.size() >= buffer_capacity || std::chrono::steady_clock::now() - _last_flush >= _flush_interval)
+		{
+			flush();
+		}
+	}
+
+	void Reporter::finish()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_finished)
+		{
+			return;
+		}
+		start();
+		write_footer(_buffer);
+		_finished = true;
+		flush();
+	}
+
+	bool Reporter::good() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return static_cast<bool>(*_os);
+	}
+
+	void Reporter::start()
+	{
+		if (!_started)
+		{
+			_started = true;
+			write_header(_buffer);
+		}
+	}
+
+	void Reporter::flush()
+	{
+		if (!_buffer.empty())
+		{
+			_os->write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+			_buffer.clear();
+		}
+		_os->flush();
+		_last_flush = std::chrono::steady_clock::now();
+	}
+
+	void Junit_Reporter::write_header(std::string& out)
+	{
+		out += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n<testsuite name=\"utest\">\n";
+	}
+
+	void Junit_Reporter::write_result(std::string& out, const Result& res)
+	{
+		out += "<testcase classname=\"";
+		detail::append_xml_escaped(out, res.info ? res.info->category : "", true);
+		out += "\" name=\"";
+		detail::append_xml_escaped(out, res.info ? res.info->name : "", true);
+		detail::append_case_suffix(out, res);
+		out += "\" file=\"";
+		detail::append_xml_escaped(out, res.info ? res.info->file : "", true);
+		out += "\" line=\"";
+		out += std::to_string(res.info ? res.info->line : 0);
+		out += "\" time=\"";
+		detail::append_seconds(out, res.duration);
+		out += "\"";
+		if (res.status == Status::pass)
+		{
+			out += "/>\n";
+			return;
+		}
+		out += ">\n";
+		if (res.status == Status::not_run)
+		{
+			out += "<skipped/>\n";
+		}
+		for (const auto& f : res.failures)
+		{
+			const std::string text = f.str();
+			out += res.status == Status::timeout ? "<error type=\"" : "<failure type=\"";
+			out += status_name(res.status);
+			out += "\" message=\"";
+			detail::append_xml_escaped(out, text.c_str(), true);
+			out += "\">";
+			detail::append_xml_escaped(out, f.file());
+			out += '(';
+			out += std::to_string(f.line());
+			out += "): ";
+			detail::append_xml_escaped(out, text.c_str());
+			out += res.status == Status::timeout ? "</error>\n" : "</failure>\n";
+		}
+		out += "</testcase>\n";
+	}
+
+	void Junit_Reporter::write_footer(std::string& out)
+	{
+		out += "</testsuite>\n</testsuites>\n";
+	}
+
+	void Tap_Reporter::write_header(std::string& out)
+	{
+		out += "TAP version 13\n";
+	}
+
+	void Tap_Reporter::write_result(std::string& out, const Result& res)
+	{
+		out += res.status == Status::pass ? "ok " : "not ok ";
+		out += std::to_string(++_count);
+		out += " - ";
+		if (res.info)
+		{
+			out += res.info->category;
+			out += '.';
+			out += res.info->name;
+			detail::append_case_suffix(out, res);
+		}
+		if (res.status == Status::not_run)
+		{
+			out += " # SKIP not run";
+		}
+		out += '\n';
+		if (res.failures.empty())
+		{
+			return;
+		}
+		out += "  ---\n  status: ";
+		out += status_name(res.status);
+		out += "\n  failures:\n";
+		for (const auto& f : res.failures)
+		{
+			// JSON strings are valid YAML flow scalars and need no further thought about quoting
+			out += "    - at: ";
+			detail::append_json_string(out, (std::string(f.file()) + ":" + std::to_string(f.line())).c_str());
+			out += "\n      message: ";
+			detail::append_json_string(out, f.str().c_str());
+			out += '\n';
+		}
+		out += "  ...\n";
+	}
+
+	void Tap_Reporter::write_footer(std::string& out)
+	{
+		out += "1..";
+		out += std::to_string(_count);
+		out += '\n';
+	}
+
+	void Json_Lines_Reporter::write_result(std::string& out, const Result& res)
+	{
+		out += "{\"name\":";
+		detail::append_json_string(out, res.info ? res.info->name : "");
+		out += ",\"category\":";
+		detail::append_json_string(out, res.info ? res.info->category : "");
+		out += ",\"file\":";
+		detail::append_json_string(out, res.info ? res.info->file : "");
+		out += ",\"line\":";
+		out += std::to_string(res.info ? res.info->line : 0);
+		if (res.info && res.info->parameterized())
+		{
+			out += ",\"case\":";
+			out += std::to_string(res.case_index);
+		}
+		out += ",\"status\":\"";
+		out += status_name(res.status);
+		out += "\",\"duration_ns\":";
+		out += std::to_string(res.duration.count());
+		out += ",\"setup_ns\":";
+		out += std::to_string(res.setup_duration.count());
+		out += ",\"test_ns\":";
+		out += std::to_string(res.test_duration.count());
+		out += ",\"teardown_ns\":";
+		out += std::to_string(res.teardown_duration.count());
+		if (res.allocations.tracked)
+		{
+			const auto& al = res.allocations;
+			out += ",\"allocations\":{\"count\":";
+			out += std::to_string(al.count);
+			out += ",\"bytes\":";
+			out += std::to_string(al.bytes);
+			out += ",\"peak_bytes\":";
+			out += std::to_string(al.peak_bytes);
+			out += ",\"leaked_count\":";
+			out += std::to_string(al.leaked_count);
+			out += ",\"leaked_bytes\":";
+			out += std::to_string(al.leaked_bytes);
+			out += '}';
+		}
+		if (res.counters.tracked)
+		{
+			const auto& c = res.counters;
+			const std::pair<const char*, double> fields[] = {
+				{ "cycles", c.cycles }, { "instructions", c.instructions }, { "branch_misses", c.branch_misses },
+				{ "cache_misses", c.cache_misses } };
+			out += ",\"counters\":{";
+			for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i)
+			{
+				out += i ? ",\"" : "\"";
+				out += fields[i].first;
+				out += "\":";
+				detail::append_number(out, fields[i].second);
+			}
+			out += '}';
+		}
+		if (res.benchmark.samples)
+		{
+			const auto& b = res.benchmark;
+			out += ",\"benchmark\":{\"iterations\":";
+			out += std::to_string(b.iterations);
+			out += ",\"samples\":";
+			out += std::to_string(b.samples);
+			const std::pair<const char*, double> fields[] = {
+				{ "min", b.min }, { "median", b.median }, { "mean", b.mean }, { "p99", b.p99 }, { "stddev", b.stddev } };
+			for (const auto& field : fields)
+			{
+				out += ",\"";
+				out += field.first;
+				out += "\":";
+				detail::append_number(out, field.second);
+			}
+			out += '}';
+		}
+		out += ",\"failures\":[";
+		for (size_t i = 0; i < res.failures.size(); ++i)
+		{
+			const auto& f = res.failures[i];
+			out += i ? ",{\"file\":" : "{\"file\":";
+			detail::append_json_string(out, f.file());
+			out += ",\"line\":";
+			out += std::to_string(f.line());
+			out += ",\"message\":";
+			detail::append_json_string(out, f.str().c_str());
+			out += '}';
+		}
+		out += "]}\n";
+	}
+
+	namespace detail
+	{
+		static const char result_log_magic[8] = { 'U', 'T', 'L', 'O', 'G', '0', '0', '1' };
+
+		enum Result_Log_Tag : unsigned char
+		{
+			result_log_string = 1,		// the length, the bytes and a terminating zero
+			result_log_test = 2,		// the ids of the name, category and file strings, then the line
+			result_log_result = 3
+		};
+
+		// the optional parts of a result record
+		enum Result_Log_Part : unsigned char
+		{
+			result_log_benchmark = 1,
+			result_log_allocations = 2,
+			result_log_counters = 4
+		};
+
+		void append_varint(std::string& out, unsigned long long value)
+		{
+			while (value >= 0x80)
+			{
+				out += static_cast<char>(static_cast<unsigned char>(value) | 0x80);
+				value >>= 7;
+			}
+			out += static_cast<char>(value);
+		}
+
+		// zigzag, so small negative numbers stay short
+		void append_signed_varint(std::string& out, const long long value)
+		{
+			append_varint(out, (static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63));
+		}
+
+		void append_duration(std::string& out, const std::chrono::nanoseconds duration)
+		{
+			append_varint(out, duration.count() > 0 ? static_cast<unsigned long long>(duration.count()) : 0);
+		}
+
+		void append_double(std::string& out, const double value)
+		{
+			char bytes[sizeof(double)];
+			std::memcpy(bytes, &value, sizeof(bytes));
+			out.append(bytes, sizeof(bytes));
+		}
+
+		// Reads back what the functions above append. Reading past the end clears ok() and returns zeros.
+		class Result_Log_Cursor final
+		{
+		public:
+			Result_Log_Cursor(const unsigned char* begin, const unsigned char* end)
+				: _p(begin)
+				, _end(end)
+				, _ok(true)
+			{}
+
+			bool ok() const { return _ok; }
+			bool at_end() const { return _p == _end; }
+			const unsigned char* position() const { return _p; }
+
+			unsigned char byte()
+			{
+				if (_p == _end)
+				{
+					_ok = false;
+					return 0;
+				}
+				return *_p++;
+			}
+
+			unsigned long long varint()
+			{
+				unsigned long long value = 0;
+				for (unsigned shift = 0; shift < 64; shift += 7)
+				{
+					const unsigned char b = byte();
+					value |= static_cast<unsigned long long>(b & 0x7f) << shift;
+					if (!(b & 0x80))
+					{
+						return value;
+					}
+				}
+				_ok = false;
+				return 0;
+			}
+
+			long long signed_varint()
+			{
+				const unsigned long long v = varint();
+				return static_cast<long long>(v >> 1) ^ -static_cast<long long>(v & 1);
+			}
+
+			std::chrono::nanoseconds duration()
+			{
+				return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(varint()));
+			}
+
+			double real()
+			{
+				double value = 0;
+				if (static_cast<size_t>(_end - _p) < sizeof(value))
+				{
+					_ok = false;
+					_p = _end;
+					return 0;
+				}
+				std::memcpy(&value, _p, sizeof(value));
+				_p += sizeof(value);
+				return value;
+			}
+
+			// the `length` bytes of a string and its terminating zero, which stay where they are
+			const char* text(const unsigned long long length)
+			{
+				if (static_cast<unsigned long long>(_end - _p) <= length || _p[length] != 0)
+				{
+					_ok = false;
+					_p = _end;
+					return "";
+				}
+				const char* const start = reinterpret_cast<const char*>(_p);
+				_p += length + 1;
+				return start;
+			}
+
+		private:
+			const unsigned char* _p;
+			const unsigned char* _end;
+			bool _ok;
+		};
+
+		class Result_Log_Encoder final
+		{
+		public:
+			Result_Log_Encoder()
+				: _strings()
+				, _tests()
+				, _infos()
+				, _failure_ids()
+				, _entry()
+				, _messages()
+				, _base()
+				, _has_base(false)
+			{}
+
+			void write_header(std::string& out)
+			{
+				out.append(result_log_magic, sizeof(result_log_magic));
+			}
+
+			unsigned long long test(std::string& out, const char* name, const char* category, const char* file, const int line)
+			{
+				const auto key = std::make_tuple(string(out, name), string(out, category), string(out, file), line);
+				const auto itr = _tests.find(key);
+				if (itr != _tests.end())
+				{
+					return itr->second;
+				}
+				const unsigned long long id = _tests.size();
+				_tests.emplace(key, id);
+				out += static_cast<char>(result_log_test);
+				append_varint(out, std::get<0>(key));
+				append_varint(out, std::get<1>(key));
+				append_varint(out, std::get<2>(key));
+				append_signed_varint(out, line);
+				return id;
+			}
+
+			void write_result(std::string& out, const unsigned long long test_id, const Result_Log_Entry& e)
+			{
+				// the strings of the failures are defined ahead of the record that uses them
+				_failure_ids.clear();
+				for (const auto& f : e.failures)
+				{
+					_failure_ids.push_back(string(out, f.message));
+					_failure_ids.push_back(string(out, f.file));
+				}
+
+				out += static_cast<char>(result_log_result);
+				append_varint(out, test_id);
+				append_varint(out, e.case_index);
+				out += static_cast<char>(e.status);
+				append_varint(out, e.worker);
+				append_signed_varint(out, static_cast<long long>(e.started.count()));
+				append_duration(out, e.duration);
+				append_duration(out, e.setup_duration);
+				append_duration(out, e.test_duration);
+				append_duration(out, e.teardown_duration);
+
+				const unsigned char parts = (e.benchmark.samples ? result_log_benchmark : 0)
+					| (e.allocations.tracked ? result_log_allocations : 0) | (e.counters.tracked ? result_log_counters : 0);
+				out += static_cast<char>(parts);
+				if (parts & result_log_benchmark)
+				{
+					const auto& b = e.benchmark;
+					append_varint(out, b.iterations);
+					append_varint(out, b.samples);
+					for (const double v : { b.min, b.median, b.mean, b.p99, b.stddev })
+					{
+						append_double(out, v);
+					}
+				}
+				if (parts & result_log_allocations)
+				{
+					const auto& a = e.allocations;
+					for (const unsigned long long v : { a.count, a.bytes, a.peak_bytes, a.leaked_count, a.leaked_bytes })
+					{
+						append_varint(out, v);
+					}
+				}
+				if (parts & result_log_counters)
+				{
+					const auto& c = e.counters;
+					for (const double v : { c.cycles, c.instructions, c.branch_misses, c.cache_misses })
+					{
+						append_double(out, v);
+					}
+				}
+
+				append_varint(out, e.failures.size());
+				for (size_t i = 0; i < e.failures.size(); ++i)
+				{
+					append_varint(out, _failure_ids[2 * i]);
+					append_varint(out, _failure_ids[2 * i + 1]);
+					append_signed_varint(out, e.failures[i].line);
+				}
+			}
+
+			void write_result(std::string& out, const Result& res)
+			{
+				const Info* const ti = res.info;
+				auto itr = _infos.find(ti);
+				if (itr == _infos.end())
+				{
+					const auto id = ti ? test(out, ti->name, ti->category, ti->file, ti->line) : test(out, "", "", "", 0);
+					itr = _infos.emplace(ti, id).first;
+				}
+				if (!_has_base)
+				{
+					_base = res.started;
+					_has_base = true;
+				}
+
+				_entry.case_index = res.case_index;
+				_entry.status = res.status;
+				_entry.worker = res.worker;
+				_entry.started = std::chrono::duration_cast<std::chrono::nanoseconds>(res.started - _base);
+				_entry.duration = res.duration;
+				_entry.setup_duration = res.setup_duration;
+				_entry.test_duration = res.test_duration;
+				_entry.teardown_duration = res.teardown_duration;
+				_entry.benchmark = res.benchmark;
+				_entry.allocations = res.allocations;
+				_entry.counters = res.counters;
+				if (_messages.size() < res.failures.size())
+				{
+					_messages.resize(res.failures.size());
+				}
+				_entry.failures.clear();
+				for (size_t i = 0; i < res.failures.size(); ++i)
+				{
+					const auto& f = res.failures[i];
+					_messages[i] = f.str();
+					_entry.failures.push_back(Result_Log_Entry::Failure_Entry{ _messages[i].c_str(), f.file(), f.line() });
+				}
+				write_result(out, itr->second, _entry);
+			}
+
+		private:
+			unsigned long long string(std::string& out, const char* text)
+			{
+				const std::string key(text ? text : "");
+				const auto itr = _strings.find(key);
+				if (itr != _strings.end())
+				{
+					return itr->second;
+				}
+				const unsigned long long id = _strings.size();
+				out += static_cast<char>(result_log_string);
+				append_varint(out, key.size());
+				out.append(key.c_str(), key.size() + 1);
+				_strings.emplace(key, id);
+				return id;
+			}
+
+			std::unordered_map<std::string, unsigned long long> _strings;
+			std::map<std::tuple<unsigned long long, unsigned long long, unsigned long long, int>, unsigned long long> _tests;
+			std::unordered_map<const Info*, unsigned long long> _infos;		// tests already written by the reporter
+			std::vector<unsigned long long> _failure_ids;
+			Result_Log_Entry _entry;
+			std::vector<std::string> _messages;
+			std::chrono::steady_clock::time_point _base;	// Result_Log_Entry::started counts from here
+			bool _has_base;
+		};
+	}
+
+	Result_Log_Reporter::Result_Log_Reporter(std::ostream& os, const std::chrono::milliseconds flush_interval)
+		: Reporter(os, flush_interval)
+		, _encoder(new detail::Result_Log_Encoder())
+	{}
+
+	Result_Log_Reporter::Result_Log_Reporter(const std::string& path, const std::chrono::milliseconds flush_interval)
+		: Reporter(path, flush_interval)
+		, _encoder(new detail::Result_Log_Encoder())
+	{}
+
+	Result_Log_Reporter::~Result_Log_Reporter()
+	{
+		finish();
+	}
+
+	void Result_Log_Reporter::write_header(std::string& out)
+	{
+		_encoder->write_header(out);
+	}
+
+	void Result_Log_Reporter::write_result(std::string& out, const Result& res)
+	{
+		_encoder->write_result(out, res);
+	}
+
+	Result_Log::Result_Log()
+		: _data(nullptr)
+		, _size(0)
+		, _mapping(nullptr)
+		, _mapped(0)
+		, _copy()
+		, _strings()
+		, _tests()
+		, _results(0)
+	{}
+
+	Result_Log::~Result_Log()
+	{
+		close();
+	}
+
+	void Result_Log::close()
+	{
+#if defined(__unix__) || defined(__APPLE__)
+		if (_mapping)
+		{
+			::munmap(_mapping, _mapped);
+		}
+#endif
+		_data = nullptr;
+		_size = 0;
+		_mapping = nullptr;
+		_mapped = 0;
+		_copy.clear();
+		_strings.clear();
+		_tests.clear();
+		_results = 0;
+	}
+
+	bool Result_Log::open(const std::string& path)
+	{
+		close();
+#if defined(__unix__) || defined(__APPLE__)
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+		struct stat st;
+		if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(detail::result_log_magic)))
+		{
+			::close(fd);
+			return false;
+		}
+		void* const mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (mapping == MAP_FAILED)
+		{
+			return false;
+		}
+		_mapping = mapping;
+		_mapped = static_cast<size_t>(st.st_size);
+		_data = static_cast<const unsigned char*>(mapping);
+		const size_t size = _mapped;
+#else
+		std::ifstream in(path, std::ios::binary);
+		_copy.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		_data = _copy.data();
+		const size_t size = _copy.size();
+#endif
+		if (size < sizeof(detail::result_log_magic)
+			|| std::memcmp(_data, detail::result_log_magic, sizeof(detail::result_log_magic)) != 0)
+		{
+			close();
+			return false;
+		}
+
+		// index the strings and tests, and find where the last whole record ends
+		detail::Result_Log_Cursor cursor(_data + sizeof(detail::result_log_magic), _data + size);
+		const unsigned char* end = cursor.position();
+		Entry scratch;
+		while (!cursor.at_end())
+		{
+			const unsigned char tag = cursor.byte();
+			if (tag == detail::result_log_string)
+			{
+				const char* const text = cursor.text(cursor.varint());
+				if (cursor.ok())
+				{
+					_strings.push_back(text);
+				}
+			}
+			else if (tag == detail::result_log_test)
+			{
+				const char* const name = string_at(cursor.varint());
+				const char* const category = string_at(cursor.varint());
+				const char* const file = string_at(cursor.varint());
+				const int line = static_cast<int>(cursor.signed_varint());
+				if (cursor.ok() && name && category && file)
+				{
+					_tests.push_back(Test_Definition{ name, category, file, line });
+				}
+				else
+				{
+					break;
+				}
+			}
+			else if (tag == detail::result_log_result)
+			{
+				size_t test = 0;
+				if (!decode(cursor, scratch, test))
+				{
+					break;
+				}
+				++_results;
+			}
+			else
+			{
+				break;
+			}
+			if (!cursor.ok())
+			{
+				break;
+			}
+			end = cursor.position();
+		}
+		_size = static_cast<size_t>(end - _data);
+		return true;
+	}
+
+	const char* Result_Log::string_at(const unsigned long long id) const
+	{
+		return id < _strings.size() ? _strings[static_cast<size_t>(id)] : nullptr;
+	}
+
+	bool Result_Log::decode(detail::Result_Log_Cursor& cursor, Entry& e, size_t& test) const
+	{
+		const unsigned long long test_id = cursor.varint();
+		if (test_id >= _tests.size())
+		{
+			return false;
+		}
+		test = static_cast<size_t>(test_id);
+		const auto& def = _tests[test];
+		e.name = def.name;
+		e.category = def.category;
+		e.file = def.file;
+		e.line = def.line;
+		e.case_index = static_cast<size_t>(cursor.varint());
+		const unsigned char status = cursor.byte();
+		if (status > static_cast<unsigned char>(Status::timeout))
+		{
+			return false;
+		}
+		e.status = static_cast<Status>(status);
+		e.worker = static_cast<unsigned>(cursor.varint());
+		e.started = std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(cursor.signed_varint()));
+		e.duration = cursor.duration();
+		e.setup_duration = cursor.duration();
+		e.test_duration = cursor.duration();
+		e.teardown_duration = cursor.duration();
+
+		const unsigned char parts = cursor.byte();
+		e.benchmark = Benchmark_Stats();
+		if (parts & detail::result_log_benchmark)
+		{
+			auto& b = e.benchmark;
+			b.iterations = cursor.varint();
+			b.samples = static_cast<unsigned>(cursor.varint());
+			b.min = cursor.real();
+			b.median = cursor.real();
+			b.mean = cursor.real();
+			b.p99 = cursor.real();
+			b.stddev = cursor.real();
+		}
+		e.allocations = Allocation_Stats();
+		if (parts & detail::result_log_allocations)
+		{
+			auto& a = e.allocations;
+			a.tracked = true;
+			a.count = cursor.varint();
+			a.bytes = cursor.varint();
+			a.peak_bytes = cursor.varint();
+			a.leaked_count = cursor.varint();
+			a.leaked_bytes = cursor.varint();
+		}
+		e.counters = Counter_Stats();
+		if (parts & detail::result_log_counters)
+		{
+			auto& c = e.counters;
+			c.tracked = true;
+			c.cycles = cursor.real();
+			c.instructions = cursor.real();
+			c.branch_misses = cursor.real();
+			c.cache_misses = cursor.real();
+		}
+
+		const unsigned long long failure_count = cursor.varint();
+		e.failures.clear();
+		for (unsigned long long i = 0; i < failure_count && cursor.ok(); ++i)
+		{
+			const char* const message = string_at(cursor.varint());
+			const char* const file = string_at(cursor.varint());
+			const int line = static_cast<int>(cursor.signed_varint());
+			if (!message || !file)
+			{
+				return false;
+			}
+			e.failures.push_back(Entry::Failure_Entry{ message, file, line });
+		}
+		return cursor.ok();
+	}
+
+	void Result_Log::scan(const std::function<void(const Entry&, size_t)>& func) const
+	{
+		if (!_data)
+		{
+			return;
+		}
+		// open() checked every record up to _size, so only results need decoding
+		detail::Result_Log_Cursor cursor(_data + sizeof(detail::result_log_magic), _data + _size);
+		Entry entry;
+		while (!cursor.at_end())
+		{
+			const unsigned char tag = cursor.byte();
+			if (tag == detail::result_log_string)
+			{
+				cursor.text(cursor.varint());
+			}
+			else if (tag == detail::result_log_test)
+			{
+				cursor.varint();
+				cursor.varint();
+				cursor.varint();
+				cursor.varint();
+			}
+			else
+			{
+				size_t test = 0;
+				decode(cursor, entry, test);
+				func(entry, test);
+			}
+		}
+	}
+
+	void Result_Log::for_each(const std::function<void(const Entry&)>& func) const
+	{
+		scan([&func](const Entry& entry, size_t) { func(entry); });
+	}
+
+	bool Result_Log::merge(const std::vector<std::string>& inputs, const std::string& output)
+	{
+		std::ofstream out(output, std::ios::binary | std::ios::trunc);
+		detail::Result_Log_Encoder encoder;
+		std::string buffer;
+		buffer.reserve(Reporter::buffer_capacity);
+		encoder.write_header(buffer);
+
+		// an input that can't be read fails the merge, but the others are still written
+		bool complete = true;
+		static const unsigned long long unmapped = ~0ull;
+		for (const auto& path : inputs)
+		{
+			Result_Log log;
+			if (!log.open(path))
+			{
+				complete = false;
+				continue;
+			}
+			std::vector<unsigned long long> ids(log._tests.size(), unmapped);
+			log.scan([&](const Entry& entry, const size_t test)
+			{
+				if (ids[test] == unmapped)
+				{
+					ids[test] = encoder.test(buffer, entry.name, entry.category, entry.file, entry.line);
+				}
+				encoder.write_result(buffer, ids[test], entry);
+				if (buffer.size() >= Reporter::buffer_capacity)
+				{
+					out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+					buffer.clear();
+				}
+			});
+		}
+		out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		return complete && static_cast<bool>(out);
+	}
+
+	namespace detail
+	{
+		static std::atomic<unsigned long long> trace_recorder_ids(0);
+
+		void append_microseconds(std::string& out, const std::chrono::nanoseconds duration)
+		{
+			char text[32];
+			std::snprintf(text, sizeof(text), "%.3f", static_cast<double>(duration.count()) / 1000.0);
+			out += text;
+		}
+	}
+
+	Trace_Recorder::Trace_Recorder()
+		: _id(++detail::trace_recorder_ids)
+		, _mutex()
+		, _buffers()
+	{
+	}
+
+	Trace_Recorder::Buffer& Trace_Recorder::local_buffer()
+	{
+		struct Cached
+		{
+			unsigned long long id;
+			Buffer* buffer;
+		};
+		static thread_local Cached cached = { 0, nullptr };
+		if (cached.id != _id)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_buffers.emplace_back(new Buffer());
+			cached = Cached{ _id, _buffers.back().get() };
+		}
+		return *cached.buffer;
+	}
+
+	void Trace_Recorder::record(const Result& res)
+	{
+		if (!res.info)
+		{
+			return;
+		}
+		local_buffer().push_back(Event{ res.info, res.case_index, res.status, res.worker, res.started,
+			res.setup_duration, res.test_duration, res.teardown_duration });
+	}
+
+	size_t Trace_Recorder::size() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		size_t count = 0;
+		for (const auto& buffer : _buffers)
+		{
+			count += buffer->size();
+		}
+		return count;
+	}
+
+	bool Trace_Recorder::write(std::ostream& os) const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto origin = std::chrono::steady_clock::time_point::max();
+		std::set<unsigned> workers;
+		for (const auto& buffer : _buffers)
+		{
+			for (const auto& e : *buffer)
+			{
+				origin = std::min(origin, e.started);
+				workers.insert(e.worker);
+			}
+		}
+
+		std::string out("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+		bool first = true;
+		auto begin_event = [&out, &first]()
+		{
+			out += first ? "\n{" : ",\n{";
+			first = false;
+		};
+		for (const unsigned worker : workers)
+		{
+			begin_event();
+			out += "\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+			out += std::to_string(worker);
+			out += ",\"args\":{\"name\":\"";
+			out += worker ? "worker " + std::to_string(worker) : std::string("main");
+			out += "\"}}";
+		}
+
+		// one complete ("X") event per test, with its phases nested inside it on the same row
+		auto append_span = [&](const char* name, const char* category, const unsigned worker,
+			const std::chrono::nanoseconds start, const std::chrono::nanoseconds duration)
+		{
+			begin_event();
+			out += "\"name\":";
+			detail::append_json_string(out, name);
+			out += ",\"cat\":";
+			detail::append_json_string(out, category);
+			out += ",\"ph\":\"X\",\"pid\":1,\"tid\":";
+			out += std::to_string(worker);
+			out += ",\"ts\":";
+			detail::append_microseconds(out, start);
+			out += ",\"dur\":";
+			detail::append_microseconds(out, duration);
+		};
+		for (const auto& buffer : _buffers)
+		{
+			for (const auto& e : *buffer)
+			{
+				const auto start = std::chrono::duration_cast<std::chrono::nanoseconds>(e.started - origin);
+				std::string name(e.info->category);
+				name += '.';
+				name += e.info->name;
+				if (e.info->parameterized())
+				{
+					name += '/';
+					name += std::to_string(e.case_index);
+				}
+				append_span(name.c_str(), e.info->category, e.worker, start,
+					e.setup_duration + e.test_duration + e.teardown_duration);
+				out += ",\"args\":{\"status\":\"";
+				out += status_name(e.status);
+				out += "\",\"file\":";
+				detail::append_json_string(out, e.info->file);
+				out += ",\"line\":";
+				out += std::to_string(e.info->line);
+				out += "}}";
+
+				const std::pair<const char*, std::chrono::nanoseconds> phases[] = {
+					{ "pre_test", e.setup_duration }, { "execute_test", e.test_duration }, { "post_test", e.teardown_duration } };
+				auto phase_start = start;
+				for (const auto& phase : phases)
+				{
+					if (phase.second.count() > 0)
+					{
+						append_span(phase.first, "phase", e.worker, phase_start, phase.second);
+						out += '}';
+					}
+					phase_start += phase.second;
+				}
+			}
+		}
+		out += "\n]}\n";
+		os.write(out.data(), static_cast<std::streamsize>(out.size()));
+		return static_cast<bool>(os);
+	}
+
+	bool Trace_Recorder::save(const std::string& path) const
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		return out && write(out);
+	}
+
+	bool Baseline::save(const std::string& path) const
+	{
+		std::ofstream out(path);
+		if (!out)
+		{
+			return false;
+		}
+		out << "# utest baseline: name, category, samples, iterations, min, median, mean, p99, stddev (ns per iteration)"
+			<< " [allocations=count,bytes,peak bytes] [instructions=count]\n";
+		out.precision(17);
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (const auto& e : _entries)
+		{
+			const auto& st = e.stats;
+			out << e.name << '\t' << e.category << '\t' << st.samples << ' ' << st.iterations << ' ' << st.min << ' '
+				<< st.median << ' ' << st.mean << ' ' << st.p99 << ' ' << st.stddev;
+			if (e.allocations.tracked)
+			{
+				const auto& al = e.allocations;
+				out << " allocations=" << al.count << ',' << al.bytes << ',' << al.peak_bytes;
+			}
+			if (e.instructions > 0)
+			{
+				out << " instructions=" << e.instructions;
+			}
+			out << '\n';
+		}
+		return static_cast<bool>(out);
+	}
+
+	// a benchmark's allocation count depends on how many iterations it ran, and the cases of a
+	// TEST_P would share one entry, so neither is compared
+	bool Baseline::tracks_allocations(const Result& res)
+	{
+		return res.allocations.tracked && res.benchmark.samples == 0 && res.info && !res.info->parameterized();
+	}
+
+	bool Baseline::tracks_instructions(const Result& res)
+	{
+		return res.counters.tracked && res.counters.instructions > 0 && res.info && !res.info->parameterized();
+	}
+
+	void Baseline::record(const Result& res)
+	{
+		const bool allocations = tracks_allocations(res);
+		const bool instructions = tracks_instructions(res);
+		if (!res.info || (res.benchmark.samples == 0 && !allocations && !instructions) || res.status != Status::pass)
+		{
+			return;
+		}
+		const auto hash = Shard::hash(res.info);
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto itr = std::lower_bound(_entries.begin(), _entries.end(), hash,
+			[](const Entry& e, const unsigned long long h) { return e.hash < h; });
+		// tests whose names collide on the hash keep one entry each, found the way lookup() finds them
+		while (itr != _entries.end() && itr->hash == hash
+			&& (itr->name != res.info->name || itr->category != res.info->category))
+		{
+			++itr;
+		}
+		if (itr == _entries.end() || itr->hash != hash)
+		{
+			itr = _entries.insert(itr, Entry{ hash, res.info->name, res.info->category, Benchmark_Stats(), Allocation_Stats(), 0 });
+		}
+		if (res.benchmark.samples)
+		{
+			itr->stats = res.benchmark;
+		}
+		if (allocations)
+		{
+			itr->allocations = res.allocations;
+		}
+		if (instructions)
+		{
+			itr->instructions = res.counters.instructions;
+		}
+	}
+
+	const Baseline::Entry* Baseline::lookup(const Info* ti) const
+	{
+		const auto hash = Shard::hash(ti);
+		auto itr = std::lower_bound(_entries.begin(), _entries.end(), hash,
+			[](const Entry& e, const unsigned long long h) { return e.hash < h; });
+		for (; itr != _entries.end() && itr->hash == hash; ++itr)
+		{
+			if (itr->name == ti->name && itr->category == ti->category)
+			{
+				return &*itr;
+			}
+		}
+		return nullptr;
+	}
+
+	bool Baseline::find(const Info* ti, Benchmark_Stats& out_stats) const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		const Entry* e = lookup(ti);
+		if (!e)
+		{
+			return false;
+		}
+		out_stats = e->stats;
+		return true;
+	}
+
+	bool Baseline::find(const Info* ti, Allocation_Stats& out_allocations) const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		const Entry* e = lookup(ti);
+		if (!e || !e->allocations.tracked)
+		{
+			return false;
+		}
+		out_allocations = e->allocations;
+		return true;
+	}
+
+	Status Baseline::mark_regressed(Result& res, const std::string& message)
+	{
+		res.status = Status::regressed;
+		res.failure = Failure::message(message, res.info->file, res.info->line);
+		res.failures.push_back(res.failure);
+		return res.status;
+	}
+
+	Status Baseline::check(Result& res) const
+	{
+		if (res.status != Status::pass || !res.info)
+		{
+			return res.status;
+		}
+
+		// instruction counts barely move between runs, so they need no significance test
+		if (tracks_instructions(res))
+		{
+			double base_instructions = 0;
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				const Entry* e = lookup(res.info);
+				base_instructions = e ? e->instructions : 0;
+			}
+			const double now = res.counters.instructions;
+			if (base_instructions > 0 && now > base_instructions * (1.0 + instruction_threshold))
+			{
+				std::ostringstream msg;
+				msg << "instructions rose " << (now - base_instructions) / base_instructions * 100 << "% from "
+					<< base_instructions << " to " << now << (res.benchmark.samples ? " per iteration" : "");
+				return mark_regressed(res, msg.str());
+			}
+		}
+
+		Allocation_Stats base_allocations;
+		if (tracks_allocations(res) && find(res.info, base_allocations))
+		{
+			const auto& now = res.allocations;
+			const double limit = static_cast<double>(base_allocations.count) * (1.0 + allocation_threshold);
+			if (now.count > base_allocations.count && static_cast<double>(now.count) > limit)
+			{
+				std::ostringstream msg;
+				msg << "allocations rose from " << base_allocations.count << " (" << base_allocations.bytes << " bytes) to "
+					<< now.count << " (" << now.bytes << " bytes)";
+				return mark_regressed(res, msg.str());
+			}
+			return res.status;
+		}
+
+		Benchmark_Stats base;
+		if (res.benchmark.samples == 0 || !find(res.info, base) || base.median <= 0)
+		{
+			return res.status;
+		}
+
+		const auto& now = res.benchmark;
+		const double slowdown = (now.median - base.median) / base.median;
+		if (slowdown <= threshold)
+		{
+			return res.status;
+		}
+		const double variance = now.stddev * now.stddev / now.samples + base.stddev * base.stddev / base.samples;
+		const double t = variance > 0 ? (now.mean - base.mean) / std::sqrt(variance) : (now.mean > base.mean ? significance : 0);
+		if (t < significance)
+		{
+			return res.status;
+		}
+
+		std::ostringstream msg;
+		msg << "median regressed " << slowdown * 100 << "% from " << base.median << "ns to " << now.median
+			<< "ns per iteration (t=" << t << ")";
+		return mark_regressed(res, msg.str());
+	}
+
+	namespace detail
+	{
+		bool glob_match(const char* pattern, const char* text)
+		{
+			// iterative matcher: on a mismatch, backtrack to just after the last '*'
+			const char* star = nullptr;
+			const char* resume = nullptr;
+			while (*text)
+			{
+				if (*pattern == '*')
+				{
+					star = pattern++;
+					resume = text;
+				}
+				else if (*pattern == '?' || *pattern == *text)
+				{
+					++pattern;
+					++text;
+				}
+				else if (star)
+				{
+					pattern = star + 1;
+					text = ++resume;
+				}
+				else
+				{
+					return false;
+				}
+			}
+			while (*pattern == '*')
+			{
+				++pattern;
+			}
+			return !*pattern;
+		}
+
+		bool has_category_prefix(const std::string& category, const std::string& prefix)
+		{
+			return category.compare(0, prefix.size(), prefix) == 0
+				&& (category.size() == prefix.size() || prefix.empty() || category[prefix.size()] == '.');
+		}
+
+		unsigned long long name_hash(const char* name)
+		{
+			return Shard::hash(name, nullptr);
+		}
+	}
+
+	bool Selector::operator()(const Info* const ti) const
+	{
+		if (_kind == Kind::name)
+		{
+			return _pattern == (ti->name ? ti->name : "");
+		}
+		return matches_category(ti->category);
+	}
+
+	bool Selector::matches_category(const char* category_) const
+	{
+		const char* const cat = category_ ? category_ : "";
+		switch (_kind)
+		{
+		case Kind::all:
+			return true;
+		case Kind::name:
+			return false;
+		case Kind::category:
+			return _pattern == cat;
+		case Kind::category_prefix:
+			return detail::has_category_prefix(cat, _pattern);
+		case Kind::glob:
+			return detail::glob_match(_pattern.c_str(), cat);
+		}
+		return false;
+	}
+
+	static const size_t empty_slot = static_cast<size_t>(-1);
+
+	Registry_Index::Registry_Index(const Container_Type& tests)
+		: _tests(tests)
+		, _slots()
+		, _buckets()
+	{
+		size_t capacity = 16;
+		while (capacity < _tests.size() * 2)
+		{
+			capacity *= 2;
+		}
+		_slots.assign(capacity, empty_slot);
+
+		std::vector<std::pair<std::string, size_t>> by_category;
+		by_category.reserve(_tests.size());
+		for (size_t i = 0; i < _tests.size(); ++i)
+		{
+			size_t slot = static_cast<size_t>(detail::name_hash(_tests[i]->name)) & (capacity - 1);
+			while (_slots[slot] != empty_slot)
+			{
+				slot = (slot + 1) & (capacity - 1);
+			}
+			_slots[slot] = i;
+			by_category.emplace_back(_tests[i]->category ? _tests[i]->category : "", i);
+		}
+
+		// stable, so positions inside each bucket stay ascending
+		std::stable_sort(by_category.begin(), by_category.end(),
+			[](const std::pair<std::string, size_t>& a, const std::pair<std::string, size_t>& b)
+			{
+				return a.first < b.first;
+			});
+		for (auto& entry : by_category)
+		{
+			if (_buckets.empty() || _buckets.back().category != entry.first)
+			{
+				_buckets.push_back(Bucket{ std::move(entry.first), std::vector<size_t>() });
+			}
+			_buckets.back().positions.push_back(entry.second);
+		}
+	}
+
+	const Info* Registry_Index::find(const char* name) const
+	{
+		const size_t mask = _slots.size() - 1;
+		for (size_t slot = static_cast<size_t>(detail::name_hash(name)) & mask; _slots[slot] != empty_slot; slot = (slot + 1) & mask)
+		{
+			const Info* ti = _tests[_slots[slot]];
+			if (std::strcmp(ti->name, name) == 0)
+			{
+				return ti;
+			}
+		}
+		return nullptr;
+	}
+
+	Registry_Index::Container_Type Registry_Index::select(const Selector& selector) const
+	{
+		Container_Type selected;
+		std::vector<size_t> positions;
+		auto take = [&positions](const Bucket& bucket)
+		{
+			positions.insert(positions.end(), bucket.positions.begin(), bucket.positions.end());
+		};
+		auto by_category = [](const Bucket& bucket, const std::string& category)
+		{
+			return bucket.category < category;
+		};
+
+		switch (selector.kind())
+		{
+		case Selector::Kind::all:
+			return _tests;
+		case Selector::Kind::name:
+		{
+			// names are normally unique, but nothing enforces it, so walk the whole probe run
+			const size_t mask = _slots.size() - 1;
+			const char* const name = selector.pattern().c_str();
+			for (size_t slot = static_cast<size_t>(detail::name_hash(name)) & mask; _slots[slot] != empty_slot; slot = (slot + 1) & mask)
+			{
+				if (std::strcmp(_tests[_slots[slot]]->name, name) == 0)
+				{
+					positions.push_back(_slots[slot]);
+				}
+			}
+			break;
+		}
+		case Selector::Kind::category:
+		{
+			auto itr = std::lower_bound(_buckets.begin(), _buckets.end(), selector.pattern(), by_category);
+			if (itr != _buckets.end() && itr->category == selector.pattern())
+			{
+				take(*itr);
+			}
+			break;
+		}
+		case Selector::Kind::category_prefix:
+			for (auto itr = std::lower_bound(_buckets.begin(), _buckets.end(), selector.pattern(), by_category);
+				itr != _buckets.end() && itr->category.compare(0, selector.pattern().size(), selector.pattern()) == 0; ++itr)
+			{
+				if (detail::has_category_prefix(itr->category, selector.pattern()))
+				{
+					take(*itr);
+				}
+			}
+			break;
+		case Selector::Kind::glob:
+			for (const auto& bucket : _buckets)
+			{
+				if (detail::glob_match(selector.pattern().c_str(), bucket.category.c_str()))
+				{
+					take(bucket);
+				}
+			}
+			break;
+		}
+
+		std::sort(positions.begin(), positions.end());
+		selected.reserve(positions.size());
+		for (const size_t i : positions)
+		{
+			selected.push_back(_tests[i]);
+		}
+		return selected;
+	}
+
+	namespace detail
+	{
+		// forward slashes, no leading "./" and no repeated separators
+		std::string normalize_path(const std::string& path)
+		{
+			std::string out;
+			out.reserve(path.size());
+			for (const char c : path)
+			{
+				const char ch = c == '\\' ? '/' : c;
+				if (ch == '/' && !out.empty() && out.back() == '/')
+				{
+					continue;
+				}
+				out += ch;
+			}
+			while (out.compare(0, 2, "./") == 0)
+			{
+				out.erase(0, 2);
+			}
+			while (!out.empty() && (out.back() == '\r' || out.back() == '\n' || out.back() == ' '))
+			{
+				out.pop_back();
+			}
+			return out;
+		}
+
+		bool has_glob(const std::string& pattern)
+		{
+			return pattern.find_first_of("*?") != std::string::npos;
+		}
+
+		// true if `path` is `suffix` or ends in "/" + suffix
+		bool path_ends_with(const std::string& path, const std::string& suffix)
+		{
+			return path.size() >= suffix.size()
+				&& path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0
+				&& (path.size() == suffix.size() || path[path.size() - suffix.size() - 1] == '/');
+		}
+
+		// quotes an argument for the POSIX shell or cmd.exe, whichever popen() will use
+		std::string shell_quote(const std::string& arg)
+		{
+#ifdef _WIN32
+			return "\"" + arg + "\"";
+#else
+			std::string out = "'";
+			for (const char c : arg)
+			{
+				out += c == '\'' ? std::string("'\\''") : std::string(1, c);
+			}
+			return out + "'";
+#endif
+		}
+
+		bool read_command_lines(const std::string& command, std::vector<std::string>& out_lines)
+		{
+#ifdef _WIN32
+			std::FILE* pipe = ::_popen(command.c_str(), "r");
+#else
+			std::FILE* pipe = ::popen(command.c_str(), "r");
+#endif
+			if (!pipe)
+			{
+				return false;
+			}
+			std::string line;
+			char buffer[512];
+			while (std::fgets(buffer, sizeof(buffer), pipe))
+			{
+				line += buffer;
+				if (!line.empty() && line.back() == '\n')
+				{
+					out_lines.push_back(line);
+					line.clear();
+				}
+			}
+			if (!line.empty())
+			{
+				out_lines.push_back(line);
+			}
+#ifdef _WIN32
+			return ::_pclose(pipe) == 0;
+#else
+			return ::pclose(pipe) == 0;
+#endif
+		}
+	}
+
+	void Change_Set::add(const std::string& path)
+	{
+		const std::string normalized = detail::normalize_path(path);
+		if (normalized.empty())
+		{
+			return;
+		}
+		auto itr = std::lower_bound(_changed.begin(), _changed.end(), normalized);
+		if (itr == _changed.end() || *itr != normalized)
+		{
+			_changed.insert(itr, normalized);
+		}
+	}
+
+	bool Change_Set::load(const std::string& path)
+	{
+		std::ifstream in(path);
+		if (!in)
+		{
+			return false;
+		}
+		std::string line;
+		while (std::getline(in, line))
+		{
+			add(line);
+		}
+		return true;
+	}
+
+	bool Change_Set::load_git_diff(const std::string& base, const std::string& repository)
+	{
+		const std::string git = "git -C " + detail::shell_quote(repository);
+		std::vector<std::string> lines;
+		if (!detail::read_command_lines(git + " diff --name-only " + detail::shell_quote(base), lines)
+			|| !detail::read_command_lines(git + " ls-files --others --exclude-standard", lines))
+		{
+			return false;
+		}
+		for (const auto& line : lines)
+		{
+			add(line);
+		}
+		return true;
+	}
+
+	void Change_Set::depend(const std::string& test_file, const std::string& dependency)
+	{
+		_dependencies.push_back(Dependency{ detail::normalize_path(test_file), detail::normalize_path(dependency) });
+	}
+
+	bool Change_Set::load_dependencies(const std::string& path)
+	{
+		std::ifstream in(path);
+		if (!in)
+		{
+			return false;
+		}
+		std::string line;
+		while (std::getline(in, line))
+		{
+			line = line.substr(0, line.find('#'));
+			const auto colon = line.find(':');
+			if (colon == std::string::npos)
+			{
+				continue;
+			}
+			std::istringstream test_field(line.substr(0, colon));
+			std::string test_file;
+			if (!(test_field >> test_file))
+			{
+				continue;
+			}
+			std::istringstream dependencies(line.substr(colon + 1));
+			std::string dependency;
+			while (dependencies >> dependency)
+			{
+				depend(test_file, dependency);
+			}
+		}
+		return true;
+	}
+
+	bool Change_Set::changed(const char* file) const
+	{
+		if (!file || _changed.empty())
+		{
+			return false;
+		}
+		// look up every trailing run of path components: "a/b/c.cpp", "b/c.cpp", "c.cpp"
+		const std::string path = detail::normalize_path(file);
+		for (size_t start = 0; start != std::string::npos; )
+		{
+			if (std::binary_search(_changed.begin(), _changed.end(), path.substr(start)))
+			{
+				return true;
+			}
+			const auto slash = path.find('/', start);
+			start = slash == std::string::npos ? std::string::npos : slash + 1;
+		}
+		// and the other way round, for a changed path that is absolute while __FILE__ is relative
+		for (const auto& c : _changed)
+		{
+			if (detail::path_ends_with(c, path))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool Change_Set::operator()(const Info* const ti) const
+	{
+		if (changed(ti->file))
+		{
+			return true;
+		}
+		if (_dependencies.empty())
+		{
+			return false;
+		}
+		const std::string file = detail::normalize_path(ti->file ? ti->file : "");
+		for (const auto& d : _dependencies)
+		{
+			const bool declares = detail::has_glob(d.test_file)
+				? detail::glob_match(d.test_file.c_str(), file.c_str()) || detail::glob_match(("*/" + d.test_file).c_str(), file.c_str())
+				: detail::path_ends_with(file, d.test_file);
+			if (!declares)
+			{
+				continue;
+			}
+			if (!detail::has_glob(d.dependency))
+			{
+				if (changed(d.dependency.c_str()))
+				{
+					return true;
+				}
+				continue;
+			}
+			for (const auto& c : _changed)
+			{
+				if (detail::glob_match(d.dependency.c_str(), c.c_str()))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	Shard Shard::from_environment()
+	{
+		auto read = [](const char* name, const unsigned fallback)
+		{
+			const char* value = std::getenv(name);
+			return value && *value ? static_cast<unsigned>(std::strtoul(value, nullptr, 10)) : fallback;
+		};
+		const unsigned count = read("UTEST_SHARD_COUNT", 1);
+		const unsigned index = read("UTEST_SHARD_INDEX", 0);
+		return Shard(count ? index % count : 0, count ? count : 1);
+	}
+
+	Registry::Container_Type Registry::shard(const Shard& s) const
+	{
+		Container_Type selected;
+		for (const auto* ti : sync())
+		{
+			if (s(ti))
+			{
+				selected.push_back(ti);
+			}
+		}
+		return selected;
+	}
+
+	Registry::Container_Type Registry::shard(const Shard& s, const Estimate_Func& estimate) const
+	{
+		const auto& all = sync();
+		if (s.count <= 1)
+		{
+			return all;
+		}
+
+		struct Entry
+		{
+			std::chrono::nanoseconds cost;
+			unsigned long long hash;
+			size_t order;
+		};
+		std::vector<Entry> entries;
+		entries.reserve(all.size());
+		std::chrono::nanoseconds known_total(0);
+		size_t known_count = 0;
+		for (size_t i = 0; i < all.size(); ++i)
+		{
+			const auto cost = estimate ? estimate(all[i]) : std::chrono::nanoseconds(0);
+			if (cost.count() > 0)
+			{
+				known_total += cost;
+				++known_count;
+			}
+			entries.push_back(Entry{ cost, Shard::hash(all[i]), i });
+		}
+		const std::chrono::nanoseconds fallback = known_count
+			? known_total / static_cast<std::chrono::nanoseconds::rep>(known_count) : std::chrono::nanoseconds(1);
+		for (auto& e : entries)
+		{
+			if (e.cost.count() <= 0)
+			{
+				e.cost = fallback;
+			}
+		}
+
+		// longest-processing-time first: hand each test to the least loaded shard. Ties are broken
+		// by the name hash so every machine computes the same plan.
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b)
+		{
+			return a.cost != b.cost ? a.cost > b.cost : a.hash < b.hash;
+		});
+		std::vector<std::chrono::nanoseconds> load(s.count, std::chrono::nanoseconds(0));
+		std::vector<size_t> mine;
+		for (const auto& e : entries)
+		{
+			const auto lightest = std::min_element(load.begin(), load.end()) - load.begin();
+			load[lightest] += e.cost;
+			if (static_cast<unsigned>(lightest) == s.index)
+			{
+				mine.push_back(e.order);
+			}
+		}
+
+		std::sort(mine.begin(), mine.end());
+		Container_Type selected;
+		selected.reserve(mine.size());
+		for (const auto i : mine)
+		{
+			selected.push_back(all[i]);
+		}
+		return selected;
+	}
+
 	Registry::Registry()
 		: _tests()
+		, _synced(nullptr)
+		, _index()
+	{
+	}
+
+	const Registry_Index& Registry::index() const
+	{
+		const auto& all = sync();
+		if (!_index || _index->size() != all.size())
+		{
+			_index.reset(new Registry_Index(all));
+		}
+		return *_index;
+	}
+
+	const Info* Registry::_linked = nullptr;
+
+	Registry::Container_Type& Registry::sync() const
+	{
+		if (_linked != _synced)
+		{
+			const size_t first = _tests.size();
+			for (const Info* ti = _linked; ti != _synced; ti = ti->next)
+			{
+				_tests.push_back(ti);
+			}
+			// the list is newest first
+			std::reverse(_tests.begin() + static_cast<std::ptrdiff_t>(first), _tests.end());
+			_synced = _linked;
+		}
+		return _tests;
+	}
+
+#if UTEST_CPP_TRACK_ALLOCATIONS
+	namespace detail
+	{
+		// put in front of every block operator new hands out; the size keeps the blocks aligned
+		struct alignas(std::max_align_t) Block_Header
+		{
+			size_t size;
+			unsigned long long scope;	// the id of the scope that counted it, 0 for none
+		};
+
+		static std::atomic<unsigned long long> allocation_scope_ids(0);
+
+		void* allocate_tracked(const size_t size)
+		{
+			void* block = std::malloc(sizeof(Block_Header) + size);
+			if (!block)
+			{
+				return nullptr;
+			}
+			auto* header = static_cast<Block_Header*>(block);
+			header->size = size;
+			header->scope = 0;
+			if (Allocation_Scope* scope = Allocation_Scope::current())
+			{
+				header->scope = scope->id();
+				scope->allocated(size);
+			}
+			return header + 1;
+		}
+
+		void free_tracked(void* ptr)
+		{
+			if (!ptr)
+			{
+				return;
+			}
+			auto* header = static_cast<Block_Header*>(ptr) - 1;
+			if (header->scope != 0)
+			{
+				// usually the innermost scope, but a case may free what an earlier case of its instance left
+				for (Allocation_Scope* scope = Allocation_Scope::current(); scope && !scope->freed(header->scope, header->size);
+					scope = scope->previous())
+				{
+				}
+			}
+			std::free(header);
+		}
+
+		// what the standard asks of operator new: retry through the new handler until there is none
+		void* allocate(const size_t size, const bool nothrow)
+		{
+			for (;;)
+			{
+				if (void* ptr = allocate_tracked(size))
+				{
+					return ptr;
+				}
+				const std::new_handler handler = std::get_new_handler();
+				if (!handler)
+				{
+					if (nothrow)
+					{
+						return nullptr;
+					}
+#if UTEST_CPP_NO_EXCEPTIONS
+					std::abort();
+#else
+					throw std::bad_alloc();
+#endif
+				}
+#if UTEST_CPP_NO_EXCEPTIONS
+				handler();
+#else
+				try
+				{
+					handler();
+				}
+				catch (const std::bad_alloc&)
+				{
+					if (nothrow)
+					{
+						return nullptr;
+					}
+					throw;
+				}
+#endif
+			}
+		}
+
+		Allocation_Scope::Allocation_Scope(Allocation_Stats& stats, const bool instance)
+			: _stats(stats)
+			, _previous(current())
+			, _id(++allocation_scope_ids)
+			, _live_count(0)
+			, _live_bytes(0)
+			, _stopped(_previous && &_previous->_stats == &stats)
+			, _instance(instance)
+			, _handed_over()
+		{
+			if (_stopped)
+			{
+				return;
+			}
+			_stats = Allocation_Stats();
+			_stats.tracked = true;
+			current() = this;
+		}
+
+		Allocation_Scope::~Allocation_Scope()
+		{
+			stop();
+		}
+
+		void Allocation_Scope::stop()
+		{
+			if (_stopped)
+			{
+				return;
+			}
+			_stopped = true;
+			_stats.leaked_count = _live_count;
+			_stats.leaked_bytes = _live_bytes;
+			for (const auto& h : _handed_over)
+			{
+				h.stats->leaked_count = h.live_count;
+				h.stats->leaked_bytes = h.live_bytes;
+			}
+			if (_previous && _previous->_instance && _live_count)
+			{
+				const Allocation_Pause untracked;
+				_previous->_handed_over.push_back(Handed_Over{ _id, &_stats, _live_count, _live_bytes });
+			}
+			current() = _previous;
+		}
+
+		void Allocation_Scope::allocated(const size_t size)
+		{
+			++_stats.count;
+			_stats.bytes += size;
+			++_live_count;
+			_live_bytes += size;
+			if (_live_bytes > _stats.peak_bytes)
+			{
+				_stats.peak_bytes = _live_bytes;
+			}
+		}
+
+		bool Allocation_Scope::freed(const unsigned long long scope, const size_t size)
+		{
+			if (scope == _id)
+			{
+				--_live_count;
+				_live_bytes -= size;
+				return true;
+			}
+			for (auto& h : _handed_over)
+			{
+				if (h.id == scope)
+				{
+					--h.live_count;
+					h.live_bytes -= size;
+					if (h.live_count == 0)
+					{
+						// all of it was freed after all, so there is nothing left to settle when this one stops
+						h.stats->leaked_count = 0;
+						h.stats->leaked_bytes = 0;
+						h = _handed_over.back();
+						_handed_over.pop_back();
+					}
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Blocks allocated while paused belong to no scope, so freeing them later counts nowhere
+		Allocation_Pause::Allocation_Pause()
+			: _paused(Allocation_Scope::current())
+		{
+			Allocation_Scope::current() = nullptr;
+		}
+
+		Allocation_Pause::~Allocation_Pause()
+		{
+			Allocation_Scope::current() = _paused;
+		}
+	}
+#else
+	namespace detail
+	{
+		Allocation_Pause::Allocation_Pause()
+			: _paused(nullptr)
+		{}
+
+		Allocation_Pause::~Allocation_Pause()
+		{
+			(void)_paused;
+		}
+	}
+#endif	// UTEST_CPP_TRACK_ALLOCATIONS
+
+#if UTEST_CPP_PERF_COUNTERS
+	namespace detail
 	{
+		// Counters of the thread that opened them, kept running for the thread's lifetime and read as
+		// one group, so taking a sample is a single read(). Opened again after a fork, because the
+		// counters a forked worker inherits still count the parent's thread.
+		class Counter_Group final
+		{
+		public:
+			static Counter_Group& get()
+			{
+				static thread_local Counter_Group group;
+				if (group._pid != ::getpid())
+				{
+					group.close();
+					group.open();
+				}
+				return group;
+			}
+
+			~Counter_Group()
+			{
+				close();
+			}
+
+			bool read(Counter_Sample& out_sample) const
+			{
+				if (_leader < 0)
+				{
+					return false;
+				}
+				struct
+				{
+					unsigned long long count;
+					unsigned long long time_enabled;
+					unsigned long long time_running;
+					unsigned long long values[4];
+				} data;
+				const auto n = ::read(_leader, &data, sizeof(data));
+				if (n < static_cast<ssize_t>(3 * sizeof(unsigned long long)))
+				{
+					return false;
+				}
+				out_sample.time_enabled = data.time_enabled;
+				out_sample.time_running = data.time_running;
+				for (size_t i = 0; i < 4; ++i)
+				{
+					out_sample.values[i] = _slots[i] >= 0 ? data.values[_slots[i]] : 0;
+				}
+				return true;
+			}
+
+		private:
+			Counter_Group()
+				: _pid(-1)
+				, _leader(-1)
+				, _fds{ -1, -1, -1, -1 }
+				, _slots{ -1, -1, -1, -1 }
+			{}
+
+			void open()
+			{
+				_pid = ::getpid();
+				static const unsigned long long events[4] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+					PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES };
+				int opened = 0;
+				for (size_t i = 0; i < 4; ++i)
+				{
+					perf_event_attr attr;
+					std::memset(&attr, 0, sizeof(attr));
+					attr.size = sizeof(attr);
+					attr.type = PERF_TYPE_HARDWARE;
+					attr.config = events[i];
+					attr.exclude_kernel = 1;
+					attr.exclude_hv = 1;
+					attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+					const int fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, _leader, 0));
+					if (fd < 0)
+					{
+						// without cycles there is no group; the others are optional
+						if (i == 0)
+						{
+							return;
+						}
+						continue;
+					}
+					if (i == 0)
+					{
+						_leader = fd;
+					}
+					_fds[i] = fd;
+					_slots[i] = opened++;
+				}
+			}
+
+			void close()
+			{
+				for (size_t i = 0; i < 4; ++i)
+				{
+					if (_fds[i] >= 0)
+					{
+						::close(_fds[i]);
+					}
+					_fds[i] = -1;
+					_slots[i] = -1;
+				}
+				_leader = -1;
+			}
+
+			pid_t _pid;
+			int _leader;
+			int _fds[4];
+			int _slots[4];		// position of each event in the group's read, -1 when it isn't open
+		};
+
+		bool sample_counters(Counter_Sample& out_sample)
+		{
+			return Counter_Group::get().read(out_sample);
+		}
+
+		Counter_Stats counter_delta(const Counter_Sample& from, const Counter_Sample& to, const double divisor)
+		{
+			Counter_Stats stats;
+			const unsigned long long running = to.time_running - from.time_running;
+			const unsigned long long enabled = to.time_enabled - from.time_enabled;
+			if (running == 0 || divisor <= 0)
+			{
+				return stats;
+			}
+			// the kernel multiplexes counters when there are more than the PMU has; scale back up
+			const double scale = static_cast<double>(enabled) / static_cast<double>(running) / divisor;
+			double* const fields[4] = { &stats.cycles, &stats.instructions, &stats.branch_misses, &stats.cache_misses };
+			for (size_t i = 0; i < 4; ++i)
+			{
+				*fields[i] = static_cast<double>(to.values[i] - from.values[i]) * scale;
+			}
+			stats.tracked = true;
+			return stats;
+		}
 	}
+#endif	// UTEST_CPP_PERF_COUNTERS
 
 #endif	// UTEST_CPP_IMPLEMENTATION
 }
+
+#if defined(UTEST_CPP_IMPLEMENTATION) && UTEST_CPP_TRACK_ALLOCATIONS
+// The replaceable global allocation functions, so every allocation in the program goes through the
+// counting above. Over-aligned allocations keep the library's versions and are not counted.
+void* operator new(std::size_t size) { return utest::detail::allocate(size, false); }
+void* operator new[](std::size_t size) { return utest::detail::allocate(size, false); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return utest::detail::allocate(size, true); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return utest::detail::allocate(size, true); }
+void operator delete(void* ptr) noexcept { utest::detail::free_tracked(ptr); }
+void operator delete[](void* ptr) noexcept { utest::detail::free_tracked(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { utest::detail::free_tracked(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { utest::detail::free_tracked(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { utest::detail::free_tracked(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { utest::detail::free_tracked(ptr); }
+#endif
@@ -0,0 +1,1241 @@
+#pragma once
+/*
+utest - The micro unit test framework for C++14
+
+Author - Oli Wilkinson (https://github.com/evolutional/upptest)
+
+The part of upptest.h a test file needs: the TEST, TEST_F and TEST_P macros and the asserts. It
+leaves out the runners, reporters and the standard headers they need, so source files that only
+declare tests compile faster when they include this instead. upptest.h includes it, and still
+provides the implementation.
+
+This is free and unencumbered software released into the public domain; see upptest.h.
+*/
+
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <iosfwd>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define UTEST_CPP_COLD	__attribute__((noinline, cold))
+#define UTEST_CPP_LIKELY(x)	__builtin_expect(!!(x), 1)
+#elif defined(_MSC_VER)
+#define UTEST_CPP_COLD	__declspec(noinline)
+#define UTEST_CPP_LIKELY(x)	(x)
+#else
+#define UTEST_CPP_COLD
+#define UTEST_CPP_LIKELY(x)	(x)
+#endif
+
+#ifndef UTEST_CPP_NO_EXCEPTIONS
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define UTEST_CPP_NO_EXCEPTIONS 0
+#else
+#define UTEST_CPP_NO_EXCEPTIONS 1
+#endif
+#endif
+
+#if UTEST_CPP_NO_EXCEPTIONS
+#include <csetjmp>
+#endif
+
+namespace utest
+{
+#define TEST_FIXTURE(name)		class name : public utest::Test	
+#define SETUP()			virtual void pre_test() override
+#define TEARDOWN()		virtual void post_test() override
+#define TEST_AUTO_NAME(name)	g_utestautoreg_test_##name
+#define TEST_F_OPT(name, fixture, category, options)	\
+	class name : public fixture	\
+	{	\
+		public:	\
+			name() : fixture() {}	\
+			void execute_test() override;	\
+			static std::unique_ptr<utest::Test> create() { return std::make_unique< name >(); }	\
+			static utest::Test* emplace(void* storage) { return ::new (storage) name(); }	\
+			static utest::Info s_info;	\
+	};	\
+	utest::Info name::s_info(&name::create, &name::emplace, sizeof(name), alignof(name),	\
+		#name, category, __FILE__, __LINE__, options, nullptr, ::utest::detail::suite_of< name >(0));	\
+	namespace { utest::Auto_Registered_Test TEST_AUTO_NAME(name)(&name::s_info); } \
+	void name::execute_test()
+
+#define TEST_F(name, fixture, category)	TEST_F_OPT(name, fixture, category, utest::Test_Options())
+#define TEST_F_SERIAL(name, fixture, category)	TEST_F_OPT(name, fixture, category, utest::Test_Options().serial())
+#define TEST_F_EXCLUSIVE(name, fixture, category, group)	TEST_F_OPT(name, fixture, category, utest::Test_Options().exclusive(group))
+#define TEST_F_TIMEOUT(name, fixture, category, ms)	TEST_F_OPT(name, fixture, category, utest::Test_Options().timeout(std::chrono::milliseconds(ms)))
+
+#define TEST(name, category)	TEST_F(name, utest::Test, category)
+#define TEST_OPT(name, category, options)	TEST_F_OPT(name, utest::Test, category, options)
+#define TEST_SERIAL(name, category)	TEST_F_SERIAL(name, utest::Test, category)
+#define TEST_EXCLUSIVE(name, category, group)	TEST_F_EXCLUSIVE(name, utest::Test, category, group)
+#define TEST_TIMEOUT(name, category, ms)	TEST_F_TIMEOUT(name, utest::Test, category, ms)
+
+#define TEST_P_F_OPT(name, fixture, category, table, options)	\
+	class name : public fixture	\
+	{	\
+		public:	\
+			name() : fixture(), _case(0) {}	\
+			void execute_test() override;	\
+			void select_case(const size_t index) override { _case = index; }	\
+			static const auto& param_table() { static const auto& t = table; return t; }	\
+			decltype(auto) param() const { return ::utest::detail::param_at(param_table(), _case); }	\
+			size_t case_index() const { return _case; }	\
+			static size_t case_count() { return ::utest::detail::param_count(param_table()); }	\
+			static std::unique_ptr<utest::Test> create() { return std::make_unique< name >(); }	\
+			static utest::Test* emplace(void* storage) { return ::new (storage) name(); }	\
+			static utest::Info s_info;	\
+		private:	\
+			size_t _case;	\
+	};	\
+	utest::Info name::s_info(&name::create, &name::emplace, sizeof(name), alignof(name),	\
+		#name, category, __FILE__, __LINE__, options, &name::case_count, ::utest::detail::suite_of< name >(0));	\
+	namespace { utest::Auto_Registered_Test TEST_AUTO_NAME(name)(&name::s_info); } \
+	void name::execute_test()
+
+#define TEST_P_F(name, fixture, category, table)	TEST_P_F_OPT(name, fixture, category, table, utest::Test_Options())
+#define TEST_P(name, category, table)	TEST_P_F(name, utest::Test, category, table)
+#define TEST_P_OPT(name, category, table, options)	TEST_P_F_OPT(name, utest::Test, category, table, options)
+
+#define UASSERT(e)	::utest::assert::expr(e, __FILE__ ,__LINE__)
+#define UASSERT_EQ(expected, actual)	::utest::assert::eq(expected, actual, __FILE__ ,__LINE__)
+#define UASSERT_NEQ(not_expected, actual)	::utest::assert::neq(not_expected, actual, __FILE__ ,__LINE__)
+#define UASSERT_TRUE(v)	::utest::assert::is_true(v, __FILE__ ,__LINE__)
+#define UASSERT_FALSE(v)	::utest::assert::is_false(v, __FILE__ ,__LINE__)
+#define UASSERT_NULL(ptr)	::utest::assert::is_null(ptr, __FILE__ ,__LINE__)
+#define UASSERT_NOT_NULL(ptr)	::utest::assert::is_not_null(ptr, __FILE__ ,__LINE__)
+#define UASSERT_FAIL(msg)	::utest::assert::fail(msg, __FILE__ ,__LINE__)
+#define UASSERT_NEAR(expected, actual, tolerance)	::utest::assert::near(expected, actual, tolerance, __FILE__ ,__LINE__)
+#define UASSERT_RANGE_EQ(expected, actual)	::utest::assert::range_eq(expected, actual, __FILE__ ,__LINE__)
+#define UASSERT_MEM_EQ(expected, actual, size)	::utest::assert::mem_eq(expected, actual, size, __FILE__ ,__LINE__)
+
+#define UEXPECT(e)	::utest::expect::expr(e, __FILE__ ,__LINE__)
+#define UEXPECT_EQ(expected, actual)	::utest::expect::eq(expected, actual, __FILE__ ,__LINE__)
+#define UEXPECT_NEQ(not_expected, actual)	::utest::expect::neq(not_expected, actual, __FILE__ ,__LINE__)
+#define UEXPECT_TRUE(v)	::utest::expect::is_true(v, __FILE__ ,__LINE__)
+#define UEXPECT_FALSE(v)	::utest::expect::is_false(v, __FILE__ ,__LINE__)
+#define UEXPECT_NULL(ptr)	::utest::expect::is_null(ptr, __FILE__ ,__LINE__)
+#define UEXPECT_NOT_NULL(ptr)	::utest::expect::is_not_null(ptr, __FILE__ ,__LINE__)
+#define UEXPECT_FAIL(msg)	::utest::expect::fail(msg, __FILE__ ,__LINE__)
+#define UEXPECT_NEAR(expected, actual, tolerance)	::utest::expect::near(expected, actual, tolerance, __FILE__ ,__LINE__)
+#define UEXPECT_RANGE_EQ(expected, actual)	::utest::expect::range_eq(expected, actual, __FILE__ ,__LINE__)
+#define UEXPECT_MEM_EQ(expected, actual, size)	::utest::expect::mem_eq(expected, actual, size, __FILE__ ,__LINE__)
+
+	class Failure;
+
+	namespace detail
+	{
+		// The types the standard streams know how to write are formatted out of line, so that a test
+		// file needs no <ostream>. Anything else is written through its own operator<<.
+		void write_value(std::ostream& os, const bool value);
+		void write_value(std::ostream& os, const char value);
+		void write_value(std::ostream& os, const signed char value);
+		void write_value(std::ostream& os, const unsigned char value);
+		void write_value(std::ostream& os, const long long value);
+		void write_value(std::ostream& os, const unsigned long long value);
+		void write_value(std::ostream& os, const double value);
+		void write_value(std::ostream& os, const long double value);
+		void write_value(std::ostream& os, const char* value);
+		void write_value(std::ostream& os, const signed char* value);
+		void write_value(std::ostream& os, const unsigned char* value);
+		void write_value(std::ostream& os, const void* value);
+		void write_value(std::ostream& os, const std::string& value);
+
+		struct Exact_Operand {};		// has a write_value() of its own
+		struct Signed_Operand {};
+		struct Unsigned_Operand {};
+		struct Address_Operand {};		// a pointer to an object, written as its address
+		struct Streamed_Operand {};
+
+		template<typename T>
+		struct operand_kind
+		{
+			typedef typename std::decay<T>::type decayed;
+			typedef typename std::remove_pointer<decayed>::type pointee;
+			typedef typename std::remove_cv<pointee>::type bare_pointee;
+			static const bool is_character = std::is_same<decayed, char>::value || std::is_same<decayed, signed char>::value
+				|| std::is_same<decayed, unsigned char>::value;
+			static const bool is_character_string = std::is_pointer<decayed>::value && !std::is_volatile<pointee>::value
+				&& (std::is_same<bare_pointee, char>::value || std::is_same<bare_pointee, signed char>::value
+					|| std::is_same<bare_pointee, unsigned char>::value);
+			static const bool is_address = std::is_pointer<decayed>::value && std::is_object<pointee>::value
+				&& !std::is_volatile<pointee>::value;
+
+			typedef typename std::conditional<std::is_same<decayed, bool>::value || is_character
+				|| std::is_floating_point<decayed>::value || is_character_string || std::is_same<decayed, std::string>::value,
+				Exact_Operand,
+				typename std::conditional<std::is_integral<decayed>::value,
+					typename std::conditional<std::is_signed<decayed>::value, Signed_Operand, Unsigned_Operand>::type,
+					typename std::conditional<is_address, Address_Operand, Streamed_Operand>::type>::type>::type type;
+		};
+
+		template<typename T>
+		void write_operand(std::ostream& os, const T& value, Exact_Operand) { write_value(os, value); }
+
+		template<typename T>
+		void write_operand(std::ostream& os, const T& value, Signed_Operand) { write_value(os, static_cast<long long>(value)); }
+
+		template<typename T>
+		void write_operand(std::ostream& os, const T& value, Unsigned_Operand)
+		{
+			write_value(os, static_cast<unsigned long long>(value));
+		}
+
+		template<typename T>
+		void write_operand(std::ostream& os, const T& value, Address_Operand) { write_value(os, static_cast<const void*>(value)); }
+
+		template<typename T>
+		void write_operand(std::ostream& os, const T& value, Streamed_Operand) { os << value; }
+
+		template<typename T>
+		void write_operand(std::ostream& os, const void* value)
+		{
+			write_operand(os, *static_cast<const T*>(value), typename operand_kind<T>::type());
+		}
+
+		typedef void (*Write_Operand_Func)(std::ostream& os, const void* value);
+
+		// "<prefix><first>] saw [<second>]"
+		void write_comparison(std::ostream& os, const char* prefix, const Write_Operand_Func write_first, const void* first,
+			const Write_Operand_Func write_second, const void* second);
+
+		typedef void (*Write_Comparison_Func)(std::ostream& os, const char* prefix, const void* first, const void* second);
+
+		// formats a comparison whose operands can't be kept for later
+		std::string format_comparison(const Write_Comparison_Func write, const char* prefix, const void* first,
+			const void* second);
+
+		// Operands whose value is all there is to print: numbers, enums, nullptr and pointers that are
+		// written as an address. Anything else, a string view or a span say, may point into memory
+		// that is gone by the time the failure is read, so it is formatted while the assert runs.
+		template<typename T>
+		struct is_deferrable_operand
+		{
+			static const bool value = std::is_arithmetic<T>::value || std::is_enum<T>::value
+				|| std::is_same<typename std::remove_cv<T>::type, std::nullptr_t>::value
+				|| (std::is_pointer<T>::value && std::is_same<typename operand_kind<T>::type, Address_Operand>::value);
+		};
+
+		// Describes how a pair of assert operands is copied into a Failure and formatted later.
+		// Only operands is_deferrable_operand allows are copied; the rest are formatted straight away.
+		template<typename T1, typename T2, size_t Capacity>
+		struct Operand_Layout
+		{
+			static const size_t second_offset = (sizeof(T1) + alignof(T2) - 1) / alignof(T2) * alignof(T2);
+			static const bool deferrable = is_deferrable_operand<T1>::value && is_deferrable_operand<T2>::value
+				&& alignof(T1) <= alignof(std::max_align_t) && alignof(T2) <= alignof(std::max_align_t)
+				&& second_offset + sizeof(T2) <= Capacity;
+
+			static void write(std::ostream& os, const char* prefix, const T1& first, const T2& second)
+			{
+				write_comparison(os, prefix, &write_operand<T1>, std::addressof(first), &write_operand<T2>, std::addressof(second));
+			}
+
+			static void write_erased(std::ostream& os, const char* prefix, const void* first, const void* second)
+			{
+				write(os, prefix, *static_cast<const T1*>(first), *static_cast<const T2*>(second));
+			}
+
+			static void store(unsigned char* storage, const T1& first, const T2& second)
+			{
+				std::memcpy(storage, std::addressof(first), sizeof(T1));
+				std::memcpy(storage + second_offset, std::addressof(second), sizeof(T2));
+			}
+
+			static void format(std::ostream& os, const char* prefix, const unsigned char* storage)
+			{
+				write(os, prefix, *reinterpret_cast<const T1*>(storage), *reinterpret_cast<const T2*>(storage + second_offset));
+			}
+		};
+	}
+
+	// A failed check. The file name is kept as the __FILE__ pointer it came from, and comparison
+	// operands are copied rather than formatted, so building a failure doesn't allocate; the
+	// message is built only when something reads it. Recording it in Result::failures does.
+	class Failure
+	{
+	public:
+		static const size_t operand_capacity = 48;
+
+		Failure()
+			: _file("")
+			, _line(0)
+			, _text(nullptr)
+			, _format(nullptr)
+			, _owned()
+		{}
+
+		// `text` must outlive the failure, which string literals do
+		static Failure literal(const char* text, const char* file_name, const int line_num)
+		{
+			Failure f(file_name, line_num);
+			f._text = text;
+			return f;
+		}
+
+		static Failure message(std::string text, const char* file_name, const int line_num)
+		{
+			Failure f(file_name, line_num);
+			f._owned = std::move(text);
+			return f;
+		}
+
+		// "<prefix><first>] saw [<second>]"
+		template<typename T1, typename T2>
+		static Failure compare(const char* prefix, const T1& first, const T2& second, const char* file_name, const int line_num)
+		{
+			typedef detail::Operand_Layout<T1, T2, operand_capacity> Layout;
+			Failure f(file_name, line_num);
+			if (Layout::deferrable)
+			{
+				f._text = prefix;
+				f._format = &Layout::format;
+				Layout::store(f._operands, first, second);
+			}
+			else
+			{
+				f._owned = detail::format_comparison(&Layout::write_erased, prefix, std::addressof(first), std::addressof(second));
+			}
+			return f;
+		}
+
+		void write(std::ostream& os) const;
+
+		std::string str() const
+		{
+			if (_format)
+			{
+				return formatted();
+			}
+			return _text ? std::string(_text) : _owned;
+		}
+
+		const char* file() const { return _file; }
+		int line() const { return _line; }
+
+	private:
+		typedef void (*Format_Func)(std::ostream& os, const char* prefix, const unsigned char* operands);
+
+		std::string formatted() const;
+
+		Failure(const char* file_name, const int line_num)
+			: _file(file_name ? file_name : "")
+			, _line(line_num)
+			, _text(nullptr)
+			, _format(nullptr)
+			, _owned()
+		{}
+
+		const char* _file;
+		int _line;
+		const char* _text;
+		Format_Func _format;
+		alignas(std::max_align_t) unsigned char _operands[operand_capacity];
+		std::string _owned;
+	};
+
+	inline std::ostream& operator << (std::ostream& os, const Failure& failure)
+	{
+		failure.write(os);
+		return os;
+	}
+
+	class assert_fail_exception
+		: public std::exception
+	{
+	public:
+		explicit assert_fail_exception(const std::string& msg, const char* file_name, const int line_num)
+			: _failure(Failure::message(msg, file_name, line_num))
+			, _what()
+		{
+		}
+		explicit assert_fail_exception(const Failure& failure)
+			: _failure(failure)
+			, _what()
+		{
+		}
+		const char* what() const throw() override
+		{
+			if (_what.empty())
+			{
+				_what = _failure.str();
+			}
+			return _what.c_str();
+		}
+		std::string what_str() const { return _failure.str(); }
+		const char* file_name() const { return _failure.file(); }
+		int line_num() const { return _failure.line(); }
+		const Failure& failure() const { return _failure; }
+	private:
+		Failure _failure;
+		mutable std::string _what;
+	};
+
+	enum class Status
+	{
+		not_run,
+		pass,
+		fail,
+		regressed,		// passed, but measurably slower than its baseline
+		timeout			// ran past its time limit
+	};
+
+	inline const char* status_name(const Status status)
+	{
+		switch (status)
+		{
+		case Status::not_run: return "not_run";
+		case Status::pass: return "pass";
+		case Status::fail: return "fail";
+		case Status::regressed: return "regressed";
+		case Status::timeout: return "timeout";
+		}
+		return "unknown";
+	}
+	
+	class Info;
+	struct Result;
+
+	namespace detail
+	{
+		// the result of the test currently executing on this thread
+		inline Result*& current_result()
+		{
+			static thread_local Result* current = nullptr;
+			return current;
+		}
+
+#if UTEST_CPP_NO_EXCEPTIONS
+		// where a failed assert returns to in the running test phase when exceptions are disabled
+		inline std::jmp_buf*& current_abort_point()
+		{
+			static thread_local std::jmp_buf* current = nullptr;
+			return current;
+		}
+
+		// Records the failure and leaves the test phase. Destructors of objects created in the
+		// test body are skipped, just as they would be after a longjmp anywhere else.
+		[[noreturn]] void abort_test(const Failure& failure);
+#endif
+
+	}
+
+	class Test;
+
+	enum class Concurrency
+	{
+		parallel,		// may run alongside any other test
+		exclusive,		// never runs alongside another test of the same exclusive group
+		serial			// runs on its own, once no other test is executing
+	};
+
+	struct Test_Options final
+	{
+		constexpr Test_Options()
+			: concurrency(Concurrency::parallel)
+			, exclusive_group(nullptr)
+			, time_limit(0)
+		{}
+
+		constexpr Test_Options serial() const
+		{
+			Test_Options opts(*this);
+			opts.concurrency = Concurrency::serial;
+			opts.exclusive_group = nullptr;
+			return opts;
+		}
+
+		constexpr Test_Options exclusive(const char* group) const
+		{
+			Test_Options opts(*this);
+			opts.concurrency = Concurrency::exclusive;
+			opts.exclusive_group = group;
+			return opts;
+		}
+
+		constexpr Test_Options timeout(const std::chrono::milliseconds limit) const
+		{
+			Test_Options opts(*this);
+			opts.time_limit = limit;
+			return opts;
+		}
+
+		Concurrency concurrency;
+		const char* exclusive_group;
+		std::chrono::milliseconds time_limit;	// zero falls back to Run_Options::timeout
+	};
+	
+	namespace detail
+	{
+		// a range that never reaches its end is a mistake in the test, found when its cases are counted
+		[[noreturn]] void invalid_range_step();
+	}
+
+	// The parameters of a TEST_P counting from `first` towards, but excluding, `last`. A negative
+	// step counts down. Floating point ranges hold every `first + i * step` short of `last`.
+	template<typename T>
+	struct Param_Range final
+	{
+		static_assert(std::is_arithmetic<T>::value, "utest::range counts through numbers");
+
+		constexpr Param_Range(const T first_, const T last_, const T step_)
+			: first(first_)
+			, last(last_)
+			, step(step_)
+		{}
+
+		constexpr size_t size() const
+		{
+			return step == T(0) ? (detail::invalid_range_step(), 0)
+				: count(std::integral_constant<bool, std::is_floating_point<T>::value>());
+		}
+
+		constexpr T operator[](const size_t index) const
+		{
+			return static_cast<T>(first + static_cast<T>(index) * step);
+		}
+
+		T first;
+		T last;
+		T step;
+
+	private:
+		constexpr bool before_last(const size_t index) const
+		{
+			return step > T(0) ? (*this)[index] < last : (*this)[index] > last;
+		}
+
+		// the quotient can be one off either way after rounding, so it is settled against operator[]
+		constexpr size_t count(std::true_type) const
+		{
+			if (!before_last(0))
+			{
+				return 0;
+			}
+			size_t n = static_cast<size_t>((last - first) / step);
+			while (before_last(n))
+			{
+				++n;
+			}
+			while (n > 1 && !before_last(n - 1))
+			{
+				--n;
+			}
+			return n;
+		}
+
+		// ceiling division of the distance, which is taken in the order that can't go negative
+		constexpr size_t count(std::false_type) const
+		{
+			return step > T(0)
+				? (last > first ? static_cast<size_t>((last - first - 1) / step) + 1 : 0)
+				: (first > last ? static_cast<size_t>((first - last - 1) / (T(0) - step)) + 1 : 0);
+		}
+	};
+
+	template<typename T>
+	constexpr Param_Range<T> range(const T first, const T last, const T step = T(1))
+	{
+		return Param_Range<T>(first, last, step);
+	}
+
+	namespace detail
+	{
+		// a TEST_P table is a C array or anything with size() and operator[]
+		template<typename T, size_t N>
+		constexpr size_t param_count(const T (&)[N])
+		{
+			return N;
+		}
+
+		template<typename T, size_t N>
+		constexpr const T& param_at(const T (&table)[N], const size_t index)
+		{
+			return table[index];
+		}
+
+		template<typename Table>
+		auto param_count(const Table& table) -> decltype(static_cast<size_t>(table.size()))
+		{
+			return static_cast<size_t>(table.size());
+		}
+
+		template<typename Table>
+		auto param_at(const Table& table, const size_t index) -> decltype(table[index])
+		{
+			return table[index];
+		}
+	}
+
+	// How the shared context of a TEST_SUITE_FIXTURE is built and destroyed. There is one per
+	// context type, and tests are grouped by its address.
+	struct Suite_Info final
+	{
+		typedef void* (*Create_Func)();
+		typedef void (*Destroy_Func)(void* context);
+
+		constexpr Suite_Info(const Create_Func create_, const Destroy_Func destroy_)
+			: create(create_)
+			, destroy(destroy_)
+		{}
+
+		Create_Func create;
+		Destroy_Func destroy;
+	};
+
+	namespace detail
+	{
+		template<class Context>
+		struct Suite_Type final
+		{
+			static void* create() { return new Context(); }
+			static void destroy(void* context) { delete static_cast<Context*>(context); }
+			static constexpr Suite_Info info{ &create, &destroy };
+		};
+
+		template<class Context>
+		constexpr Suite_Info Suite_Type<Context>::info;
+
+		// the suite of a test class deriving from Suite_Test, null for any other
+		template<class Fixture>
+		constexpr auto suite_of(int) -> decltype(&Suite_Type<typename Fixture::Suite_Context>::info)
+		{
+			return &Suite_Type<typename Fixture::Suite_Context>::info;
+		}
+
+		template<class Fixture>
+		constexpr const Suite_Info* suite_of(long)
+		{
+			return nullptr;
+		}
+	}
+
+	// Info is a literal type, so a registration built from constant arguments (which is what the
+	// TEST macros produce) is constant-initialized: no code runs and nothing is allocated for it.
+	class Info
+	{
+	public:
+		typedef std::unique_ptr<Test> (*Factory_Func)();
+		typedef Test* (*Emplace_Func)(void* storage);
+
+		constexpr Info(const Factory_Func f_, const char* name_, const char* category_, const char* file_, const int line_,
+			const Test_Options& options_ = Test_Options())
+			: Info(f_, nullptr, 0, 0, name_, category_, file_, line_, options_)
+		{}
+
+		// emplace_ constructs the test into caller-provided storage of at least size_ bytes aligned to
+		// align_, which lets the runner reuse one buffer per thread instead of allocating per test
+		typedef size_t (*Case_Count_Func)();
+
+		constexpr Info(const Factory_Func f_, const Emplace_Func emplace_, const size_t size_, const size_t align_,
+			const char* name_, const char* category_, const char* file_, const int line_,
+			const Test_Options& options_ = Test_Options(), const Case_Count_Func case_count_ = nullptr,
+			const Suite_Info* suite_ = nullptr, const bool coroutine_ = false)
+			: f(f_)
+			, emplace(emplace_)
+			, size(size_)
+			, align(align_)
+			, name(name_)
+			, category(category_)
+			, file(file_)
+			, line(line_)
+			, options(options_)
+			, next(nullptr)
+			, case_count(case_count_)
+			, suite(suite_)
+			, coroutine(coroutine_)
+		{}
+
+		// a TEST_P: one registration that runs once per entry of its parameter table
+		bool parameterized() const { return case_count != nullptr; }
+
+		Factory_Func f;
+		Emplace_Func emplace;	// optional; f is used when null
+		size_t size;
+		size_t align;
+		const char* name;
+		const char* category;
+		const char* file;
+		const int line;
+		const Test_Options options;
+		const Info* next;		// intrusive link used by Registry::link()
+		Case_Count_Func case_count;		// null unless parameterized()
+		const Suite_Info* suite;		// the shared context of a TEST_SUITE_FIXTURE test, otherwise null
+		bool coroutine;				// a TEST_ASYNC, which Runner::run_async() can keep suspended
+	};
+
+	class Default_Fail_Handler
+	{
+	public:
+#if UTEST_CPP_NO_EXCEPTIONS
+		[[noreturn]] static void handle(const Failure& failure)
+		{
+			detail::abort_test(failure);
+		}
+
+		[[noreturn]] static void handle(const std::string& message, const char* file_name = "", const int line_num = 0)
+		{
+			detail::abort_test(Failure::message(message, file_name, line_num));
+		}
+#else
+		[[noreturn]] static void handle(const Failure& failure)
+		{
+			throw assert_fail_exception(failure);
+		}
+
+		[[noreturn]] static void handle(const std::string& message, const char* file_name = "", const int line_num = 0)
+		{
+			throw assert_fail_exception(message, file_name, line_num);
+		}
+#endif
+	};
+
+	namespace detail
+	{
+		// Handlers taking a Failure get it as is; older handlers taking (message, file, line) still
+		// work, at the cost of formatting the message up front.
+		template<class Fail_Handler>
+		auto invoke_fail_handler(const Failure& failure, int) -> decltype(Fail_Handler::handle(failure), void())
+		{
+			Fail_Handler::handle(failure);
+		}
+
+		template<class Fail_Handler>
+		void invoke_fail_handler(const Failure& failure, long)
+		{
+			Fail_Handler::handle(failure.str(), failure.file(), failure.line());
+		}
+	}
+
+	// How far apart two floating point values may be for assert::near: within `max_ulps` units in
+	// the last place, or within `epsilon` of each other, which is what values near zero need.
+	struct Tolerance final
+	{
+		constexpr Tolerance()
+			: max_ulps(4)
+			, epsilon(0)
+		{}
+
+		constexpr Tolerance ulps(const unsigned long long n) const
+		{
+			Tolerance tol(*this);
+			tol.max_ulps = n;
+			return tol;
+		}
+
+		constexpr Tolerance absolute(const double e) const
+		{
+			Tolerance tol(*this);
+			tol.epsilon = e;
+			return tol;
+		}
+
+		unsigned long long max_ulps;
+		double epsilon;
+	};
+
+	namespace detail
+	{
+		// Maps the bits of a float onto integers that order the same way as the values, so the
+		// ULP distance is a subtraction. -0.0 and +0.0 both map to zero.
+		inline long long ordered_bits(const double value)
+		{
+			long long bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			return bits < 0 ? (-0x7fffffffffffffffLL - 1) - bits : bits;
+		}
+
+		inline long long ordered_bits(const float value)
+		{
+			int bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			return bits < 0 ? (-0x7fffffffLL - 1) - bits : bits;
+		}
+
+		// long double is measured in double ULPs
+		template<typename T>
+		struct ulp_type
+		{
+			typedef typename std::conditional<std::is_same<T, float>::value, float, double>::type type;
+		};
+
+		template<typename T>
+		unsigned long long ulp_distance(const T a, const T b)
+		{
+			typedef typename ulp_type<T>::type U;
+			const long long x = ordered_bits(static_cast<U>(a));
+			const long long y = ordered_bits(static_cast<U>(b));
+			return x >= y ? static_cast<unsigned long long>(x) - static_cast<unsigned long long>(y)
+				: static_cast<unsigned long long>(y) - static_cast<unsigned long long>(x);
+		}
+
+		template<typename T>
+		bool is_infinite(const T value)
+		{
+			return value == std::numeric_limits<T>::infinity() || value == -std::numeric_limits<T>::infinity();
+		}
+
+		// NaN is never near anything, itself included, and an infinity is only near itself: the
+		// largest finite value is a single ULP away from it
+		template<typename T>
+		bool near(const T expected, const T actual, const Tolerance& tol, unsigned long long& distance)
+		{
+			if (expected == actual)
+			{
+				distance = 0;
+				return true;
+			}
+			if (expected != expected || actual != actual)
+			{
+				distance = ~0ULL;
+				return false;
+			}
+			distance = ulp_distance(expected, actual);
+			if (is_infinite(expected) || is_infinite(actual))
+			{
+				return false;
+			}
+			const T diff = expected > actual ? expected - actual : actual - expected;
+			return distance <= tol.max_ulps || diff <= static_cast<T>(tol.epsilon);
+		}
+
+		Failure near_failure(const double expected, const double actual, const int digits, const unsigned long long distance,
+			const Tolerance& tol, const char* file_name, const int line_num);
+
+		template<typename...>
+		struct void_type { typedef void type; };
+
+		// A range whose elements sit in one array: a built-in array, or anything with data() and size().
+		template<typename R, typename = void>
+		struct contiguous_range
+		{
+			static const bool value = false;
+			typedef void element;
+		};
+
+		template<typename T, size_t N>
+		struct contiguous_range<T[N], void>
+		{
+			static const bool value = true;
+			typedef typename std::remove_cv<T>::type element;
+			static const T* data(const T (&range)[N]) { return range; }
+			static size_t size(const T (&)[N]) { return N; }
+		};
+
+		template<typename R>
+		struct contiguous_range<R, typename void_type<decltype(std::declval<const R&>().data()),
+			decltype(std::declval<const R&>().size())>::type>
+		{
+			typedef decltype(std::declval<const R&>().data()) pointer;
+			static const bool value = std::is_pointer<pointer>::value;
+			typedef typename std::remove_cv<typename std::remove_pointer<pointer>::type>::type element;
+			static pointer data(const R& range) { return range.data(); }
+			static size_t size(const R& range) { return static_cast<size_t>(range.size()); }
+		};
+
+		struct Memcmp_Kernel {};		// same type, equal exactly when the bytes are
+		struct Blocked_Kernel {};		// arithmetic, compared a block at a time without branching
+		struct Iterator_Kernel {};
+
+		template<typename R1, typename R2>
+		struct range_kernel
+		{
+			typedef contiguous_range<R1> first;
+			typedef contiguous_range<R2> second;
+			typedef typename first::element E1;
+			typedef typename second::element E2;
+			static const bool contiguous = first::value && second::value;
+
+			typedef typename std::conditional<contiguous && std::is_same<E1, E2>::value
+				&& (std::is_integral<E1>::value || std::is_enum<E1>::value || std::is_pointer<E1>::value),
+				Memcmp_Kernel,
+				typename std::conditional<contiguous && std::is_arithmetic<E1>::value && std::is_arithmetic<E2>::value,
+					Blocked_Kernel, Iterator_Kernel>::type>::type type;
+		};
+
+		template<typename R1, typename R2>
+		bool ranges_equal(const R1& expected, const R2& actual, Memcmp_Kernel)
+		{
+			typedef contiguous_range<R1> first;
+			typedef contiguous_range<R2> second;
+			const size_t size = first::size(expected);
+			return size == second::size(actual)
+				&& (size == 0 || std::memcmp(first::data(expected), second::data(actual), size * sizeof(*first::data(expected))) == 0);
+		}
+
+		// An early exit in the inner loop would stop the compiler vectorizing it, so each block is
+		// compared in full and only then tested.
+		template<typename R1, typename R2>
+		bool ranges_equal(const R1& expected, const R2& actual, Blocked_Kernel)
+		{
+			typedef contiguous_range<R1> first;
+			typedef contiguous_range<R2> second;
+			const size_t size = first::size(expected);
+			if (size != second::size(actual))
+			{
+				return false;
+			}
+			const auto a = first::data(expected);
+			const auto b = second::data(actual);
+			const size_t block = 64;
+			size_t i = 0;
+			for (; i + block <= size; i += block)
+			{
+				// a constant trip count, which the cheap vectorizer at -O2 needs
+				const auto x = a + i;
+				const auto y = b + i;
+				unsigned differ = 0;
+				for (size_t j = 0; j < block; ++j)
+				{
+					differ |= x[j] != y[j];
+				}
+				if (differ)
+				{
+					return false;
+				}
+			}
+			for (; i < size; ++i)
+			{
+				if (!(a[i] == b[i]))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		template<typename R1, typename R2>
+		bool ranges_equal(const R1& expected, const R2& actual, Iterator_Kernel)
+		{
+			using std::begin;
+			using std::end;
+			auto i = begin(expected);
+			auto j = begin(actual);
+			const auto i_end = end(expected);
+			const auto j_end = end(actual);
+			for (; i != i_end && j != j_end; ++i, ++j)
+			{
+				if (!(*i == *j))
+				{
+					return false;
+				}
+			}
+			return i == i_end && j == j_end;
+		}
+
+		// The first mismatch of a failed range or memory assert and the elements around it, by address.
+		struct Mismatch_Window
+		{
+			static const size_t radius = 4;
+
+			Mismatch_Window(const char* what_, const char* separator_, const Write_Operand_Func write_expected_,
+				const Write_Operand_Func write_actual_)
+				: what(what_)
+				, separator(separator_)
+				, write_expected(write_expected_)
+				, write_actual(write_actual_)
+				, index(0)
+				, first(0)
+				, expected_size(0)
+				, actual_size(0)
+				, expected_count(0)
+				, actual_count(0)
+			{}
+
+			const char* what;		// "Ranges differ at index" or "Memory differs at offset"
+			const char* separator;
+			Write_Operand_Func write_expected;
+			Write_Operand_Func write_actual;
+			size_t index;
+			size_t first;			// the index of expected[0] and actual[0]
+			size_t expected_size;
+			size_t actual_size;
+			size_t expected_count;
+			size_t actual_count;
+			const void* expected[radius * 2 + 1];
+			const void* actual[radius * 2 + 1];
+		};
+
+		// "<what> 5: expected [... 3, 4, 5, 6 ...] saw [... 3, 4, 9, 6 ...]"
+		std::string format_mismatch(const Mismatch_Window& window);
+
+		// writes the byte at `value` as two hex digits
+		void write_byte(std::ostream& os, const void* value);
+
+		// Walks the range once, keeping the addresses of the elements in the window; returns its size.
+		template<typename R>
+		size_t collect_window(const R& range, const size_t first, const void** window, size_t& count)
+		{
+			using std::begin;
+			using std::end;
+			size_t index = 0;
+			count = 0;
+			for (auto it = begin(range), last = end(range); it != last; ++it, ++index)
+			{
+				if (index >= first && count < Mismatch_Window::radius * 2 + 1)
+				{
+					window[count++] = std::addressof(*it);
+				}
+			}
+			return index;
+		}
+
+		template<typename R1, typename R2>
+		size_t mismatch_index(const R1& expected, const R2& actual)
+		{
+			using std::begin;
+			using std::end;
+			size_t index = 0;
+			auto i = begin(expected);
+			auto j = begin(actual);
+			for (const auto i_end = end(expected), j_end = end(actual); i != i_end && j != j_end; ++i, ++j, ++index)
+			{
+				if (!(*i == *j))
+				{
+					break;
+				}
+			}
+			return index;
+		}
+
+		template<typename R>
+		struct range_element
+		{
+			typedef typename std::decay<decltype(*std::begin(std::declval<const R&>()))>::type type;
+		};
+
+		template<typename R1, typename R2>
+		std::string describe_range_mismatch(const R1& expected, const R2& actual)
+		{
+			Mismatch_Window window("Ranges differ at index", ", ", &write_operand<typename range_element<R1>::type>,
+				&write_operand<typename range_element<R2>::type>);
+			window.index = mismatch_index(expected, actual);
+			window.first = window.index > Mismatch_Window::radius ? window.index - Mismatch_Window::radius : 0;
+			window.expected_size = collect_window(expected, window.first, window.expected, window.expected_count);
+			window.actual_size = collect_window(actual, window.first, window.actual, window.actual_count);
+			return format_mismatch(window);
+		}
+
+		std::string describe_memory_mismatch(const unsigned char* expected, const unsigned char* actual, const size_t size);
+	}
+
+	// Each assert is a compare and a branch; everything needed to report a failure lives in the
+	// out-of-line `*_failed` functions so it never gets inlined into the test body.
+	template<class Fail_Handler>
+	class Basic_Assert
+	{
+	public:
+		template<typename T1, typename T2>
+		static void eq(const T1& expected, const T2& actual, const char* file_name = "", const int line_num = 0)
+		{
+			if (UTEST_CPP_LIKELY(expected == actual))
+			{
+				return;
+			}
+			eq_failed(expected, actual, file_name, line_num);
+		}
+
+		template<typename T1, typename T2>
+		static void neq(const T1& expected, const T2& actual, const char* file_name = "", const int line_num = 0)
+		{
+			if (UTEST_CPP_LIKELY(expected != actual))
+			{
+				return;
+			}
+			neq_failed(expected, actual, file_name, line_num);
+		}
+
+		static void expr(const bool ex, const char* file_name = "", const int line_num = 0)
+		{
+			if (UTEST_CPP_LIKELY(ex))
+			{
+				return;
+			}
+			message_failed("Assert expression failed", file_name, line_num);
+		}
+
+		static void is_true(const bool condition, const char* file_name = "", const int line_num = 0)
+		{
+			if (UTEST_CPP_LIKELY(condition))
+			{
+				return;
+			}
+			message_failed("Expected [true] saw [false]", file_name, line_num);
+		}
+
+		static void is_false(const bool condition, const char* file_name = "", const int line_num = 0)
+		{
+			if (UTEST_CPP_LIKELY(!condition))
+			{
+				return;
+			}
+			message_failed("Expected [false] saw [true]", file_name, line_num);
+		}
+
+		template<typename T>
+		static void is_null(const T* ptr, const char* file_name = "", const int line_num = 0)
+		{
+			if (UTEST_CPP_LIKELY(ptr == nullptr))
+			{
+				return;
+			}
+			message_failed("Expected [nullptr]", file_name, line_num);
+		}
+
+		template<typename T>
+		static void is_not_null(const T* ptr, const char* file_name = "", const int line_num = 0)
+		{
+			if (UTEST_CPP_LIKELY(ptr != nullptr))
+			{
+				return;
+			}
+			message_failed("Expected not [nullptr]", file_name, line_num);
+		}
+
+		// Floating point values within `tol`; see Tolerance
+		template<typename T1, typename T2>
+		static void near(const T1& expected, const T2& actual, const Tolerance& tol = Tolerance(), const char* file_name = "",
+			const int line_num = 0)
+		{
+			typedef typename std::common_type<T1, T2>::type T;
+			static_assert(std::is_floating_point<T>::value, "assert::near compares floating point values");
+			unsigned long long distance;
+			if (UTEST_CPP_LIKELY(detail::near(static_cast<T>(expected), static_cast<T>(actual), tol, distance)))
+			{
+				return;
+			}
+			near_failed(static_cast<double>(expected), static_cast<double>(actual), std::is_same<T, float>::value ? 9 : 17,
+				distance, tol, file_name, line_num);
+		}
+
+		// Two ranges with the same number of elements, pairwise equal. Contiguous ranges of integers
+		// are compared with memcmp; a failure reports the first mismatch and the elements around it.
+		template<typename R1, typename R2>
+		static void range_eq(const R1& expected, const R2& actual, const char* file_name = "", const int line_num = 0)
+		{
+			if (UTEST_CPP_LIKELY(detail::ranges_equal(expected, actual, typename detail::range_kernel<R1, R2>::type())))
+			{
+				return;
+			}
+			range_failed(expected, actual, file_name, line_num);
+		}
+
+		static void mem_eq(const void* expected, const void* actual, const size_t size, const char* file_name = "",
+			const int line_num = 0)
+		{
+			if (UTEST_CPP_LIKELY(size == 0 || std::memcmp(expected, actual, size) == 0))
+			{
+				return;
+			}
+			mem_failed(expected, actual, size, file_name, line_num);
+		}
+
+		static void fail(const std::string& message, const char* file_name = "", const int line_num = 0)
+		{
+			fail(Failure::message(message, file_name, line_num));
+		}
+
+		static void fail(const Failure& failure)
+		{
+			detail::invoke_fail_handler<Fail_Handler>(failure, 0);
+		}
+
+	private:
+		template<typename T1, typename T2>
+		UTEST_CPP_COLD static void eq_failed(const T1& expected, const T2& actual, const char* file_name, const int line_num)
+		{
+			fail(Failure::compare("Expected [", expected, actual, file_name, line_num));
+		}
+
+		template<typename T1, typename T2>
+		UTEST_CPP_COLD static void neq_failed(const T1& expected, const T2& actual, const char* file_name, const int line_num)
+		{
+			fail(Failure::compare("Expected not [", expected, actual, file_name, line_num));
+		}
+
+		UTEST_CPP_COLD static void near_failed(const double expected, const double actual, const int digits,
+			const unsigned long long distance, const Tolerance& tol, const char* file_name, const int line_num)
+		{
+			fail(detail::near_failure(expected, actual, digits, distance, tol, file_name, line_num));
+		}
+
+		template<typename R1, typename R2>
+		UTEST_CPP_COLD static void range_failed(const R1& expected, const R2& actual, const char* file_name, const int line_num)
+		{
+			fail(Failure::message(detail::describe_range_mismatch(expected, actual), file_name, line_num));
+		}
+
+		UTEST_CPP_COLD static void mem_failed(const void* expected, const void* actual, const size_t size,
+			const char* file_name, const int line_num)
+		{
+			fail(Failure::message(detail::describe_memory_mismatch(static_cast<const unsigned char*>(expected),
+				static_cast<const unsigned char*>(actual), size), file_name, line_num));
+		}
+
+		UTEST_CPP_COLD static void message_failed(const char* message, const char* file_name, const int line_num)
+		{
+			fail(Failure::literal(message, file_name, line_num));
+		}
+	};
+
+	// Records the failure against the running test and lets it carry on, so a single run reports
+	// every failed expectation without unwinding. Outside a test it behaves like an assert.
+	class Expect_Fail_Handler
+	{
+	public:
+		static void handle(const Failure& failure);
+	};
+
+	typedef Basic_Assert<Default_Fail_Handler> assert;
+	typedef Basic_Assert<Expect_Fail_Handler> expect;
+
+	class Test
+	{
+	public:
+		virtual ~Test() {}
+
+		// picks the parameter of a TEST_P before execute(); one instance may run several cases
+		virtual void select_case(const size_t) {}
+
+		// pre_test(), the test and post_test(), timed and reported into res
+		Status execute(Result& res);
+
+	protected:
+		Test(){}
+		virtual void pre_test() {}
+		virtual void post_test() {}
+		// lets derived test kinds add their own measurements once the test has finished
+		virtual void report(Result&) {}
+	private:
+		virtual void execute_test() = 0;
+
+		// execute_test() between two readings of the hardware counters, when they are built in. Without
+		// exceptions execute() takes the readings, around the abort point a failed assert jumps to.
+		void measured_execute_test();
+
+#if UTEST_CPP_NO_EXCEPTIONS
+		// Runs one phase with an abort point for failed asserts to jump back to. Kept in its own
+		// frame so nothing execute() changes is live across the longjmp.
+		bool guarded(void (Test::*phase)());
+#endif
+	};	
+
+	// The one piece of a TEST that runs at startup: a dynamic initializer per test, which links its
+	// constant-initialized Info into the registry's intrusive list. Collecting the Infos from a
+	// linker section instead would run nothing, but each shared object has its own.
+	class Auto_Registered_Test
+	{
+	public:
+		explicit Auto_Registered_Test(Info* info);
+		explicit Auto_Registered_Test(const Info* info);
+		const Info* _info;
+	};
+}